@@ -0,0 +1,129 @@
+#include <string.h>
+
+#include "aging.h"
+#include "bitmap.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+
+/* Ages 32 counters per step, spreading each referenced bit over the top bit of its counter's byte */
+__attribute__((target("avx2")))
+static int tickAvx2(uint8_t *ages, const uint32_t *ref, int count)
+{
+	const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+		2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+	const __m256i bit = _mm256_set1_epi64x(0x8040201008040201LL);
+	const __m256i low = _mm256_set1_epi8(0x7f);
+	int i;
+
+	for (i = 0; i + 32 <= count; i += 32)
+	{
+		__m256i bits = _mm256_shuffle_epi8(_mm256_set1_epi32(ref[i / 32]), spread);
+		__m256i top = _mm256_andnot_si256(low, _mm256_cmpeq_epi8(_mm256_and_si256(bits, bit), bit));
+		__m256i age = _mm256_loadu_si256((const __m256i*) (ages + i));
+		age = _mm256_and_si256(_mm256_srli_epi16(age, 1), low);
+		_mm256_storeu_si256((__m256i*) (ages + i), _mm256_or_si256(age, top));
+	}
+	return i;
+}
+
+/* The 32 bits of a bitmap starting at bit i, which need not be word aligned */
+static uint32_t bitsAt(const uint32_t *map, int i)
+{
+	uint64_t w = map[i / 32];
+	if (i % 32 != 0)
+		w |= (uint64_t) map[i / 32 + 1] << 32;
+	return (uint32_t) (w >> (i % 32));
+}
+
+/* Finds the smallest counter of an in-use frame 32 at a time, then the first in-use frame holding it; free frames read as 0xff */
+__attribute__((target("avx2")))
+static int minAvx2(const uint8_t *ages, const uint32_t *used, int from, int to, int *end)
+{
+	const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+		2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+	const __m256i bit = _mm256_set1_epi64x(0x8040201008040201LL);
+	__m256i min = _mm256_set1_epi8((char) 0xff);
+	int i;
+
+	for (i = from; i + 32 <= to; i += 32)
+	{
+		__m256i bits = _mm256_shuffle_epi8(_mm256_set1_epi32(bitsAt(used, i)), spread);
+		__m256i free = _mm256_cmpeq_epi8(_mm256_and_si256(bits, bit), _mm256_setzero_si256());
+		min = _mm256_min_epu8(min, _mm256_or_si256(free, _mm256_loadu_si256((const __m256i*) (ages + i))));
+	}
+	*end = i;
+
+	uint8_t lanes[32];
+	uint8_t value = 0xff;
+	_mm256_storeu_si256((__m256i*) lanes, min);
+	for (i = 0; i < 32; i++)
+		if (lanes[i] < value)
+			value = lanes[i];
+
+	/* 0xff is also what free frames read as, so that case is left to the scalar scan */
+	if (value == 0xff)
+	{
+		*end = from;
+		return -1;
+	}
+
+	__m256i want = _mm256_set1_epi8((char) value);
+	for (i = from; i < *end; i += 32)
+	{
+		__m256i bits = _mm256_shuffle_epi8(_mm256_set1_epi32(bitsAt(used, i)), spread);
+		__m256i free = _mm256_cmpeq_epi8(_mm256_and_si256(bits, bit), _mm256_setzero_si256());
+		__m256i age = _mm256_or_si256(free, _mm256_loadu_si256((const __m256i*) (ages + i)));
+		unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(want, age));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	return -1;
+}
+
+static int hasAvx2()
+{
+	static int avx2 = -1;
+	if (avx2 == -1)
+	{
+		__builtin_cpu_init();
+		avx2 = __builtin_cpu_supports("avx2");
+	}
+	return avx2;
+}
+#endif
+
+/* Shifts every counter right, moving each frame's referenced bit into the top bit, then clears the referenced bits */
+void ageTick(uint8_t *ages, uint32_t *ref, int count)
+{
+	int i = 0;
+
+#if defined(__GNUC__) && defined(__x86_64__)
+	if (hasAvx2())
+		i = tickAvx2(ages, ref, count);
+#endif
+	for (; i < count; i++)
+		ages[i] = (ages[i] >> 1) | (bitTest(ref, i) << 7);
+
+	memset(ref, 0, BITMAP_WORDS(count) * sizeof(uint32_t));
+}
+
+/* Returns the frame in [from, to) with the smallest counter among those set in used, the lowest on a tie, or -1 if none is in use */
+int ageMin(const uint8_t *ages, const uint32_t *used, int from, int to)
+{
+	int best = -1;
+	int i = from;
+
+#if defined(__GNUC__) && defined(__x86_64__)
+	if (hasAvx2() && to - from >= 32)
+	{
+		best = minAvx2(ages, used, from, to, &i);
+		if (best != -1 && ages[best] == 0)
+			return best;
+	}
+#endif
+	for (; i < to; i++)
+		if (bitTest(used, i) && (best == -1 || ages[i] < ages[best]))
+			best = i;
+	return best;
+}
@@ -0,0 +1,9 @@
+#ifndef AGING_H
+#define AGING_H
+
+#include <stdint.h>
+
+void ageTick(uint8_t*, uint32_t*, int);
+int ageMin(const uint8_t*, const uint32_t*, int, int);
+
+#endif
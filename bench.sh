@@ -0,0 +1,110 @@
+#!/bin/sh
+# Runs the benchmark workloads through oss, records their numbers in
+# bench.results (one JSON object per line) and compares them against
+# bench.baseline. Exits non-zero if any number regressed past its tolerance.
+#
+#   ./bench.sh       run and compare
+#   ./bench.sh -u    run and rewrite the baseline from this run
+
+RESULTS=bench.results
+BASELINE=bench.baseline
+SEED=1
+
+# Every workload warms up, then makes a fixed number of references, so each
+# machine simulates the same work and only real time differs
+RUN="-p 18:1000 -u 2000 -n 20000"
+
+# name and oss arguments of every workload; -N sets the memory size in frames.
+# The weighted working set fits in 96 frames, so those sizes stay below that
+WORKLOADS="
+random-256	-m 1 -N 256
+random-128	-m 1 -N 128
+random-64	-m 1 -N 64
+weighted-64	-m 2 -N 64
+weighted-48	-m 2 -N 48
+weighted-32	-m 2 -N 32
+thrash-24	-m 1 -N 24
+"
+
+# Relative tolerance and the direction that counts as worse, per metric.
+# Wall clock numbers vary from machine to machine, so they get more slack.
+TOLERANCES="
+fault_ratio	0.02	up
+sim_access_ms	0.02	up
+processes	0	down
+refs_per_sec	0.50	down
+peak_rss_kb	0.50	up
+"
+
+update=false
+[ "$1" = "-u" ] && update=true
+
+field() {
+	sed -n "s/.*\"$2\": \([0-9.e+-]*\).*/\1/p" "$1"
+}
+
+: > "$RESULTS"
+echo "$WORKLOADS" | while IFS='	' read -r name args; do
+	[ -z "$name" ] && continue
+	# shellcheck disable=SC2086
+	if ! ./oss -s "$SEED" $RUN $args -o "$name.json" > /dev/null 2>&1; then
+		echo "bench: $name: oss failed" >&2
+		rm -f "$name.json"
+		exit 1
+	fi
+	sed "s/^{/{\"workload\": \"$name\", /" "$name.json" >> "$RESULTS"
+	rm -f "$name.json"
+done || exit 1
+
+if $update; then
+	{
+		echo "# workload	metric	value, written by ./bench.sh -u"
+		while read -r line; do
+			name=$(echo "$line" | sed -n 's/.*"workload": "\([^"]*\)".*/\1/p')
+			echo "$line" > bench.tmp
+			echo "$TOLERANCES" | while IFS='	' read -r metric tol dir; do
+				[ -z "$metric" ] && continue
+				printf '%s\t%s\t%s\n' "$name" "$metric" "$(field bench.tmp "$metric")"
+			done
+		done < "$RESULTS"
+	} > "$BASELINE"
+	rm -f bench.tmp
+	echo "bench: baseline written to $BASELINE"
+	exit 0
+fi
+
+if [ ! -f "$BASELINE" ]; then
+	echo "bench: no $BASELINE, run ./bench.sh -u to make one" >&2
+	exit 1
+fi
+
+failed=0
+grep -v '^#' "$BASELINE" > bench.tmp
+while IFS='	' read -r name metric base; do
+	line=$(grep "\"workload\": \"$name\"" "$RESULTS")
+	if [ -z "$line" ]; then
+		echo "bench: $name: no result" >&2
+		failed=1
+		continue
+	fi
+	value=$(echo "$line" | sed -n "s/.*\"$metric\": \([0-9.e+-]*\).*/\1/p")
+	set -- $(echo "$TOLERANCES" | grep "^$metric	")
+	tol=$2
+	dir=$3
+
+	verdict=$(awk -v v="$value" -v b="$base" -v t="$tol" -v d="$dir" 'BEGIN {
+		if (v == "") { print "missing"; exit }
+		if (d == "up" && v > b * (1 + t) + 1e-9) print "worse"
+		else if (d == "down" && v < b * (1 - t) - 1e-9) print "worse"
+		else print "ok"
+	}')
+	printf '%-14s %-14s %14s  baseline %14s  %s\n' "$name" "$metric" "$value" "$base" "$verdict"
+	[ "$verdict" != "ok" ] && failed=1
+done < bench.tmp
+rm -f bench.tmp
+
+if [ $failed -ne 0 ]; then
+	echo "bench: regressions against $BASELINE" >&2
+	exit 1
+fi
+echo "bench: all workloads within tolerance"
@@ -0,0 +1,110 @@
+#include <string.h>
+
+#include "bitmap.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+
+/* Population count of 256 bits at a time, looking each nibble up with a byte shuffle */
+__attribute__((target("avx2")))
+static int countAvx2(const uint32_t *map, int words)
+{
+	const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	__m256i sum = _mm256_setzero_si256();
+	int i;
+
+	for (i = 0; i + 8 <= words; i += 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*) (map + i));
+		__m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low)),
+			_mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+		sum = _mm256_add_epi64(sum, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+	}
+
+	int n = _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) + _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3);
+	for (; i < words; i++)
+		n += __builtin_popcount(map[i]);
+	return n;
+}
+
+/* Scalar count, compiled for the popcnt instruction */
+__attribute__((target("popcnt")))
+static int countPopcnt(const uint32_t *map, int words)
+{
+	int n = 0;
+	int i;
+
+	for (i = 0; i + 2 <= words; i += 2)
+	{
+		uint64_t w;
+		memcpy(&w, map + i, sizeof(w));
+		n += __builtin_popcountll(w);
+	}
+	if (i < words)
+		n += __builtin_popcount(map[i]);
+	return n;
+}
+#endif
+
+/* Counts the set bits of a bitmap, using the widest kernel this CPU has */
+int bitmapCount(const uint32_t *map, int words)
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+	static int (*kernel)(const uint32_t*, int) = NULL;
+
+	if (kernel == NULL)
+	{
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			kernel = countAvx2;
+		else if (__builtin_cpu_supports("popcnt"))
+			kernel = countPopcnt;
+	}
+	if (kernel != NULL)
+		return kernel(map, words);
+#endif
+
+	int n = 0;
+	int i;
+	for (i = 0; i < words; i++)
+		n += __builtin_popcount(map[i]);
+	return n;
+}
+
+/* Counts the set bits among bits [from, from + len) */
+int bitmapCountRange(const uint32_t *map, int from, int len)
+{
+	int n = 0;
+
+	while (len > 0)
+	{
+		int shift = from % 32;
+		int take = (32 - shift < len) ? 32 - shift : len;
+		uint32_t mask = (take == 32) ? ~0u : ((1u << take) - 1) << shift;
+
+		n += __builtin_popcount(map[from / 32] & mask);
+		from += take;
+		len -= take;
+	}
+	return n;
+}
+
+/* Returns the first bit in [from, to) that equals want, a whole word at a time; -1 if there is none */
+int bitmapNext(const uint32_t *map, int from, int to, bool want)
+{
+	while (from < to)
+	{
+		uint32_t v = want ? map[from / 32] : ~map[from / 32];
+
+		v &= ~0u << (from % 32);
+		if (v != 0)
+		{
+			int bit = from - from % 32 + __builtin_ctz(v);
+			return (bit < to) ? bit : -1;
+		}
+		from += 32 - from % 32;
+	}
+	return -1;
+}
@@ -0,0 +1,21 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BITMAP_WORDS(n) (((n) + 31) / 32)
+
+#define bitTest(map, i) (((map)[(i) / 32] >> ((i) % 32)) & 1)
+#define bitSet(map, i) ((map)[(i) / 32] |= 1u << ((i) % 32))
+#define bitClear(map, i) ((map)[(i) / 32] &= ~(1u << ((i) % 32)))
+
+/* For bitmaps whose words are shared between threads that each own other bits of them */
+#define bitSetAtomic(map, i) __atomic_fetch_or(&(map)[(i) / 32], 1u << ((i) % 32), __ATOMIC_RELAXED)
+#define bitClearAtomic(map, i) __atomic_fetch_and(&(map)[(i) / 32], ~(1u << ((i) % 32)), __ATOMIC_RELAXED)
+
+int bitmapCount(const uint32_t*, int);
+int bitmapCountRange(const uint32_t*, int, int);
+int bitmapNext(const uint32_t*, int, int, bool);
+
+#endif
@@ -0,0 +1,67 @@
+#include <stdlib.h>
+
+#include "cache.h"
+
+Cache *newCache(int size, int ways, int lineSize)
+{
+	Cache *cache = (Cache*) malloc(sizeof(Cache));
+	cache->size = size;
+	cache->ways = ways;
+	cache->lineSize = lineSize;
+	cache->sets = size / (ways * lineSize);
+	cache->lines = (CacheLine*) calloc(cache->sets * ways, sizeof(CacheLine));
+	cache->tick = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+	return cache;
+}
+
+/* Looks up the line holding a physical address, filling the least recently used way of its set on a miss; returns whether it hit */
+bool cacheAccess(Cache *cache, unsigned long paddr)
+{
+	unsigned long tag = paddr / cache->lineSize;
+	CacheLine *set = &cache->lines[(tag % cache->sets) * cache->ways];
+	int victim = 0;
+	int i;
+
+	cache->tick++;
+	for (i = 0; i < cache->ways; i++)
+	{
+		if (set[i].valid && set[i].tag == tag)
+		{
+			set[i].used = cache->tick;
+			cache->hits++;
+			return true;
+		}
+		if (set[victim].valid && (!set[i].valid || set[i].used < set[victim].used))
+			victim = i;
+	}
+
+	cache->misses++;
+	set[victim].tag = tag;
+	set[victim].valid = true;
+	set[victim].used = cache->tick;
+	return false;
+}
+
+/* Drops every line caching part of a physical range, as when a frame is filled from disk */
+void cacheInvalidate(Cache *cache, unsigned long paddr, int len)
+{
+	unsigned long tag;
+	int i;
+
+	for (tag = paddr / cache->lineSize; tag * cache->lineSize < paddr + len; tag++)
+	{
+		CacheLine *set = &cache->lines[(tag % cache->sets) * cache->ways];
+		for (i = 0; i < cache->ways; i++)
+			if (set[i].valid && set[i].tag == tag)
+				set[i].valid = false;
+	}
+}
+
+/* Returns how many page colors the cache has: frames of different colors never share a set */
+int cacheColors(const Cache *cache, int pageSize)
+{
+	int colors = cache->sets * cache->lineSize / pageSize;
+	return (colors > 0) ? colors : 1;
+}
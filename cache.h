@@ -0,0 +1,29 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+
+typedef struct {
+	unsigned long tag;	/* Line address, the set index included */
+	bool valid;
+	unsigned long used;
+} CacheLine;
+
+/* Set-associative, physically indexed and tagged cache with LRU replacement in each set */
+typedef struct Cache {
+	CacheLine *lines;	/* One set after another, ways lines each */
+	int size;
+	int ways;
+	int lineSize;
+	int sets;
+	unsigned long tick;
+	int hits;
+	int misses;
+} Cache;
+
+Cache *newCache(int, int, int);
+bool cacheAccess(Cache*, unsigned long);
+void cacheInvalidate(Cache*, unsigned long, int);
+int cacheColors(const Cache*, int);
+
+#endif
@@ -0,0 +1,137 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+#include "shared.h"
+
+/* Checkpoints are written to a temporary file and renamed over the target once complete */
+static void tmpPath(char *buf, const char *path)
+{
+	snprintf(buf, BUFFER_LENGTH, "%s.tmp", path);
+}
+
+bool ckptOpenWrite(Checkpoint *ckpt, const char *path)
+{
+	char tmp[BUFFER_LENGTH];
+	tmpPath(tmp, path);
+
+	ckpt->ok = true;
+	if ((ckpt->fp = fopen(tmp, "wb")) == NULL)
+		return ckpt->ok = false;
+
+	uint32_t header[2] = { CHECKPOINT_MAGIC, CHECKPOINT_VERSION };
+	ckptWrite(ckpt, header, sizeof(header));
+	return ckpt->ok;
+}
+
+bool ckptOpenRead(Checkpoint *ckpt, const char *path)
+{
+	ckpt->ok = true;
+	if ((ckpt->fp = fopen(path, "rb")) == NULL)
+		return ckpt->ok = false;
+
+	uint32_t header[2];
+	ckptRead(ckpt, header, sizeof(header));
+	if (header[0] != CHECKPOINT_MAGIC || header[1] != CHECKPOINT_VERSION)
+		ckpt->ok = false;
+	return ckpt->ok;
+}
+
+/* Closes the checkpoint, and for a written one (path given) moves it into place */
+bool ckptClose(Checkpoint *ckpt, const char *path)
+{
+	if (ckpt->fp == NULL)
+		return false;
+	if (fclose(ckpt->fp) == EOF)
+		ckpt->ok = false;
+	ckpt->fp = NULL;
+
+	if (path != NULL)
+	{
+		char tmp[BUFFER_LENGTH];
+		tmpPath(tmp, path);
+		if (!ckpt->ok || rename(tmp, path) == -1)
+		{
+			remove(tmp);
+			ckpt->ok = false;
+		}
+	}
+
+	return ckpt->ok;
+}
+
+void ckptWrite(Checkpoint *ckpt, const void *data, size_t size)
+{
+	if (ckpt->ok && fwrite(data, 1, size, ckpt->fp) != size)
+		ckpt->ok = false;
+}
+
+void ckptRead(Checkpoint *ckpt, void *data, size_t size)
+{
+	if (ckpt->ok && fread(data, 1, size, ckpt->fp) != size)
+		ckpt->ok = false;
+}
+
+/* Lists and queues are stored as a count followed by their nodes in order */
+void ckptWriteList(Checkpoint *ckpt, const List *list)
+{
+	int count = 0;
+	NodeOfList *node;
+
+	for (node = list->top; node != NULL; node = node->nxt)
+		count++;
+	ckptWrite(ckpt, &count, sizeof(count));
+
+	for (node = list->top; node != NULL; node = node->nxt)
+	{
+		int entry[3] = { node->indx, node->pg, node->frm };
+		ckptWrite(ckpt, entry, sizeof(entry));
+	}
+}
+
+void ckptReadList(Checkpoint *ckpt, List *list)
+{
+	int count = 0;
+	int i;
+
+	while (list->top != NULL)
+		pop(list);
+
+	ckptRead(ckpt, &count, sizeof(count));
+	for (i = 0; i < count && ckpt->ok; i++)
+	{
+		int entry[3];
+		ckptRead(ckpt, entry, sizeof(entry));
+		if (ckpt->ok)
+			append(list, entry[0], entry[1], entry[2]);
+	}
+}
+
+void ckptWriteQueue(Checkpoint *ckpt, const Que *que)
+{
+	QueNode *node;
+
+	ckptWrite(ckpt, &que->count, sizeof(que->count));
+	for (node = que->frnt; node != NULL; node = node->nxt)
+		ckptWrite(ckpt, &node->indx, sizeof(node->indx));
+}
+
+void ckptReadQueue(Checkpoint *ckpt, Que *que)
+{
+	int count = 0;
+	int i;
+
+	while (!isQueueEmpty(que))
+		dequeue(que);
+
+	ckptRead(ckpt, &count, sizeof(count));
+	for (i = 0; i < count && ckpt->ok; i++)
+	{
+		int indx;
+		ckptRead(ckpt, &indx, sizeof(indx));
+		if (ckpt->ok)
+			enqueue(que, indx);
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "list.h"
+#include "queue.h"
+
+#define CHECKPOINT_MAGIC 0x4f535343	/* "OSSC" */
+#define CHECKPOINT_VERSION 18
+
+typedef struct {
+	FILE *fp;
+	bool ok;
+} Checkpoint;
+
+bool ckptOpenWrite(Checkpoint*, const char*);
+bool ckptOpenRead(Checkpoint*, const char*);
+bool ckptClose(Checkpoint*, const char*);
+void ckptWrite(Checkpoint*, const void*, size_t);
+void ckptRead(Checkpoint*, void*, size_t);
+void ckptWriteList(Checkpoint*, const List*);
+void ckptReadList(Checkpoint*, List*);
+void ckptWriteQueue(Checkpoint*, const Que*);
+void ckptReadQueue(Checkpoint*, Que*);
+
+#endif
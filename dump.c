@@ -0,0 +1,153 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dump.h"
+
+#define RUNS_PER_LINE 8
+
+void dumpInit(Dump *dump, void (*flush)(const char*, size_t))
+{
+	dump->len = 0;
+	dump->flush = flush;
+}
+
+void dumpFlush(Dump *dump)
+{
+	if (dump->len == 0)
+		return;
+	dump->flush(dump->buf, dump->len);
+	dump->len = 0;
+}
+
+/* Appends formatted text to the buffer, flushing first if it would not fit */
+void dumpf(Dump *dump, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, fmt);
+	n = vsnprintf(dump->buf + dump->len, BUFFER_LENGTH - dump->len, fmt, args);
+	va_end(args);
+
+	if (n < 0 || dump->len + n < BUFFER_LENGTH)
+	{
+		if (n > 0)
+			dump->len += n;
+		return;
+	}
+
+	/* Did not fit, so flush what we had and format again into an empty buffer */
+	dumpFlush(dump);
+	va_start(args, fmt);
+	n = vsnprintf(dump->buf, BUFFER_LENGTH, fmt, args);
+	va_end(args);
+	if (n > 0)
+		dump->len = (n < BUFFER_LENGTH) ? n : BUFFER_LENGTH - 1;
+}
+
+static bool isSameFrame(const Frame *a, const Frame *b)
+{
+	return a->sp_id == b->sp_id && a->pg == b->pg;
+}
+
+/* Two neighbouring frames belong to one run if both are free, or they hold consecutive pages of one process */
+static bool isRunNext(const Frame *a, const Frame *b)
+{
+	if (a->sp_id != b->sp_id)
+		return false;
+	return a->sp_id == -1 || b->pg == a->pg + 1;
+}
+
+static void dumpRun(Dump *dump, const Frame *frames, int start, int end, int runs)
+{
+	if (runs > 0)
+		dumpf(dump, (runs % RUNS_PER_LINE == 0) ? "\n  " : " ");
+
+	if (end - start == 1)
+		dumpf(dump, "[%d]", start);
+	else
+		dumpf(dump, "[%d-%d]", start, end - 1);
+
+	if (frames[start].sp_id == -1)
+		dumpf(dump, "free");
+	else if (frames[start].sp_id == FRAME_SHARED && end - start == 1)
+		dumpf(dump, "S:%d", frames[start].pg);
+	else if (frames[start].sp_id == FRAME_SHARED)
+		dumpf(dump, "S:%d-%d", frames[start].pg, frames[end - 1].pg);
+	else if (end - start == 1)
+		dumpf(dump, "P%d:%d", frames[start].sp_id, frames[start].pg);
+	else
+		dumpf(dump, "P%d:%d-%d", frames[start].sp_id, frames[start].pg, frames[end - 1].pg);
+}
+
+/* Walks the frame table run by run; when prev is given, only frames that differ from it are written */
+static int dumpRuns(Dump *dump, const Frame *frames, const Frame *prev, int count)
+{
+	int runs = 0;
+	int i = 0;
+
+	while (i < count)
+	{
+		if (prev != NULL && isSameFrame(&frames[i], &prev[i]))
+		{
+			i++;
+			continue;
+		}
+
+		int j = i + 1;
+		while (j < count && isRunNext(&frames[j - 1], &frames[j]) && (prev == NULL || !isSameFrame(&frames[j], &prev[j])))
+			j++;
+
+		dumpRun(dump, frames, i, j, runs++);
+		i = j;
+	}
+
+	return runs;
+}
+
+/* Writes the whole frame table in run-length form */
+void dumpFrames(Dump *dump, const Frame *frames, int count)
+{
+	dumpf(dump, "Frames: ");
+	dumpRuns(dump, frames, NULL, count);
+	dumpf(dump, "\n");
+}
+
+/* Writes only the frames that changed since the previous call, then remembers the current table in prev */
+void dumpFramesDiff(Dump *dump, const Frame *frames, Frame *prev, int count)
+{
+	dumpf(dump, "Frames changed: ");
+	if (dumpRuns(dump, frames, prev, count) == 0)
+		dumpf(dump, "none");
+	dumpf(dump, "\n");
+
+	memcpy(prev, frames, count * sizeof(Frame));
+}
+
+/* Writes the frames of a list in order, collapsing ascending runs of frame numbers */
+void dumpList(Dump *dump, const List *list)
+{
+	NodeOfList *node = list->top;
+	int runs = 0;
+
+	dumpf(dump, "LRU: ");
+	while (node != NULL)
+	{
+		NodeOfList *last = node;
+		while (last->nxt != NULL && last->nxt->frm == last->frm + 1)
+			last = last->nxt;
+
+		if (runs > 0)
+			dumpf(dump, (runs % (RUNS_PER_LINE * 2) == 0) ? "\n  " : " ");
+		if (last == node)
+			dumpf(dump, "%d", node->frm);
+		else
+			dumpf(dump, "%d-%d", node->frm, last->frm);
+
+		runs++;
+		node = last->nxt;
+	}
+	dumpf(dump, "\n");
+}
@@ -0,0 +1,23 @@
+#ifndef DUMP_H
+#define DUMP_H
+
+#include <stddef.h>
+
+#include "list.h"
+#include "shared.h"
+
+/* Fixed-size output buffer that is handed to a flush callback whenever it fills up */
+typedef struct {
+	char buf[BUFFER_LENGTH];
+	size_t len;
+	void (*flush)(const char*, size_t);
+} Dump;
+
+void dumpInit(Dump*, void (*)(const char*, size_t));
+void dumpf(Dump*, const char*, ...);
+void dumpFlush(Dump*);
+void dumpFrames(Dump*, const Frame*, int);
+void dumpFramesDiff(Dump*, const Frame*, Frame*, int);
+void dumpList(Dump*, const List*);
+
+#endif
@@ -7,8 +7,6 @@
 
 #include "list.h"
 
-#define BUFFER_LENGTH 4096
-
 List *newList()
 {
     List *list = (List *)malloc(sizeof(List));
@@ -42,27 +40,6 @@ void append(List *list, int indx, int pg, int frm)
     nextHead->nxt = temp;
 }
 
-char *listString(const List *list)
-{
-    char buf[BUFFER_LENGTH];
-    NodeOfList *nxtNode = list->top;
-
-    if (nxtNode == NULL)
-        return strdup(buf);
-
-    sprintf(buf, "List:");
-    while (nxtNode != NULL)
-    {
-        sprintf(buf, "%s (%d | %d | %d)", buf, nxtNode->indx, nxtNode->pg, nxtNode->frm);
-        nxtNode = (nxtNode->nxt != NULL) ? nxtNode->nxt : NULL;
-        if (nxtNode != NULL)
-            sprintf(buf, "%s, ", buf);
-    }
-    sprintf(buf, "%s\n", buf);
-
-    return strdup(buf);
-}
-
 int removeFrmList(List *list, int indx, int pg, int frm)
 {
     NodeOfList *currHead = list->top;
@@ -85,19 +62,26 @@ int removeFrmList(List *list, int indx, int pg, int frm)
     if (currHead == list->top)
     {
         int n = currHead->frm;
+        list->top = currHead->nxt;
         free(currHead);
-        list->top = list->top->nxt;
         return n;
     }
     else
     {
-        int n = prevTop->nxt->frm;
-        free(prevTop->nxt);
+        int n = currHead->frm;
         prevTop->nxt = currHead->nxt;
+        free(currHead);
         return n;
     }
 }
 
+void push(List *list, int indx, int pg, int frm)
+{
+    NodeOfList *temp = makeListNode(indx, pg, frm);
+    temp->nxt = list->top;
+    list->top = temp;
+}
+
 void pop(List *list)
 {
     if (list->top == NULL)
@@ -127,14 +111,10 @@ bool isContains(List *list, int key)
     return true;
 }
 
-char *strdup(const char *src)
+NodeOfList *findInList(List *list, int indx, int pg, int frm)
 {
-    size_t length = strlen(src) + 1;
-    char *dest = malloc(length);
-    if (dest == NULL)
-    {
-        return NULL;
-    }
-    memcpy(dest, src, length);
-    return dest;
+    NodeOfList *node = list->top;
+    while (node != NULL && (node->indx != indx || node->pg != pg || node->frm != frm))
+        node = node->nxt;
+    return node;
 }
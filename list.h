@@ -1,6 +1,8 @@
 #ifndef LIST_H
 #define LIST_H
 
+#include <stdbool.h>
+
 typedef struct NodeOfList {
 	int indx;
 	int pg;
@@ -14,9 +16,10 @@ typedef struct {
 
 List *newList();
 void append(List*, int, int, int);
+void push(List*, int, int, int);
 void pop(List*);
 int removeFrmList(List*, int, int, int);
 bool isContains(List*, int);
-char *listString(const List*);
+NodeOfList *findInList(List*, int, int, int);
 
 #endif
@@ -1,4 +1,6 @@
 #include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
 #include <errno.h>
 #include <libgen.h>
 #include <math.h>
@@ -12,28 +14,100 @@
 
 #include <sys/ipc.h>
 #include <sys/msg.h>
+#include <sys/resource.h>
+#include <sys/epoll.h>
 #include <sys/sem.h>
 #include <sys/shm.h>
+#include <sys/signalfd.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "aging.h"
+#include "bitmap.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "dump.h"
 #include "list.h"
+#include "pcb.h"
+#include "prof.h"
 #include "queue.h"
+#include "shadow.h"
 #include "shared.h"
+#include "tlb.h"
+#include "trace.h"
 
 #define log _log
 
+/* Counters are bumped from worker threads in parallel mode */
+#define statAdd(var, n) __atomic_add_fetch(&(var), (n), __ATOMIC_RELAXED)
+
 /* Simulation functions */
 void sysInit();
 void simulation();
+void backgroundScans();
+void replayTrace();
 void processesHandler();
+bool handleProcess(int);
+void handleReference(int, unsigned int, unsigned int);
+void startWorkers();
+void stopWorkers();
+void *workerMain(void *);
+void drainPagevec(Worker *);
+TLB *tlbOf(int);
+int allocShardFrame();
+void lockIf(pthread_mutex_t *);
+void unlockIf(pthread_mutex_t *);
 void tryToSpawnTheProcess();
 void spawnTheProcess(int);
-void init_PCB(pid_t, int);
+pid_t forkUser(int, unsigned int, int);
+pid_t startUser(int, unsigned int, int);
+void startPool(int);
+void stopPool();
+void retireUser(int);
+void init_PCB(pid_t, int, unsigned int);
 int find_avail_PID();
+void handleFault(int, unsigned int, unsigned int);
+int allocFrame(int, unsigned int, unsigned int);
+int evictPage(int);
+int freeFrameCount();
+int takeFrame(Node *);
+void kswapd();
+void wssScan();
+int wssPick(PCB *, int, int, int);
+void loadControl();
+void suspendProcess();
+void resumeProcess();
+void mapFrame(int, int, int, bool);
+void releasePages(int);
+void touchPage(int, int);
+int findHugeRun(int, int);
+bool isRunFree(int);
+int nodeOrder(int, int, int *);
+int nodeOf(int);
+int parseInts(char *, int *, int);
+int parseCaches(char *);
+void cacheReference(int, int, unsigned int, int);
+void cacheInvalidateFrame(int);
+bool isHugeCandidate(int, int);
+void mapHuge(int, int, int);
+void splitHuge(int, int);
+void collapseScan();
+void collapseRegion(int, int);
+void freeFrame(int);
+NodeOfList *coldestPage(bool);
+NodeOfList *stackEntryOf(int);
+NodeOfList *agedVictim();
+NodeOfList *clockVictim();
+void duel(int, unsigned int);
+void movePage(NodeOfList *, int, int);
+void tierScan();
+void zswapStore(int, int);
+void zswapLoad(int, int);
+void zswapDrop(int, int);
+unsigned long long clockNs();
 int clckAvance(int);
 
 /* Program lifecycle functions */
@@ -41,58 +115,213 @@ void init(int, char **);
 void usage(int);
 void registerSgHandler();
 void sgHandler(int);
+void pollEvents(bool);
+void stopUsers();
+bool isIdle();
+bool checkRunLength();
+void resetStats();
 void timer(int);
 void init_IPC();
 void free_IPC();
+void saveCheckpoint();
+void restoreCheckpoint();
 
 /* Utility functions */
 void error(char *, ...);
 void crash(char *);
 void log(char *, ...);
 void flog(char *, ...);
+void logWrite(const char *, size_t);
 void sem_lock(const int);
 void sem_unlock(const int);
 void showSummary();
+void writeMetrics(FILE *);
 void showMemoryMap();
 
 static char *prgName;
 static volatile bool quit = false;
+static bool interrupted = false;	/* SIGINT arrived, so the run ends without waiting for user processes */
+static int sigFd = -1;	/* signalfd the handled signals arrive on */
+static int eventFd = -1;	/* epoll instance oss sleeps on when idle */
+static sigset_t userMask;	/* Signal mask from before blocking, restored in user processes */
+static volatile sig_atomic_t ckptPending = false;
 static bool debug = false;
+static bool pooled = false;	/* Reuse pre-forked user processes instead of forking one per simulated process */
+static pid_t *idleWorkers;	/* Pool workers waiting for a simulated process */
+static int idleCount = 0;
+static int poolSize = 0;	/* Pool workers forked so far */
+static int count_pool_assign = 0;
+static bool debugDiff = false;
+static Dump dump;
 
 /* IPC variables */
 static int shm_id = -1;
 static int msq_id = -1;
 static int semid = -1;
 static System *sys = NULL;
-static Message msg;
 
 /* Simulation variables */
 static int schm = RANDOM;
+static unsigned int seed;	/* Simulator RNG state, kept here so it can be checkpointed */
+static char *ckptPath = PATH_CHECKPOINT;
+static char *restorePath = NULL;
+static unsigned int ckptEvery = 0;	/* Simulated seconds between checkpoints, 0 for signal only */
+static unsigned int nxt_ckpt = 0;
 static Que *que;	/* Process que */
-static List *rfrnce; /* Reference string */
 static List *stack;		/* LRU stack */
 static SysTime nxt_spawn;
 static int act_count = 0;
 static int spawn_count = 0;
 static int exit_count = 0;
-static pid_t pids[PROCESSES_MAX];
-static int memory[MAX_FRAMES];
+static PcbTable *pcbs;	/* Process table, indexed by simulated PID */
+static int procMax = PROCESSES_MAX;	/* Processes alive at once */
+static int procTotal = PROCESSES_TOTAL;	/* Processes spawned over the run */
+static int *traceIds;	/* Simulated PID of each trace process, -1 before it is seen */
+static uint32_t memory[BITMAP_WORDS(MAX_FRAMES)];	/* Frame bitmap, a set bit for every frame in use */
+static Frame frames[MAX_FRAMES];	/* Frame table */
+static Frame dumped[MAX_FRAMES];	/* Frame table as of the last debug dump */
 static int count_mem_acc = 0;
 static int count_pg_fault = 0;
-static unsigned int tot_acc_time = 0;
+static int sharedPages = 0;	/* Pages [0, sharedPages) of every process form a shared segment */
+static int sharedFrm[MAX_PAGES];	/* Frame holding each shared page, -1 when not resident */
+static int frameCount = MAX_FRAMES;	/* Frames in use, the sum of the node sizes */
+static Node nodes[MAX_NODES];
+static int nodeCount = 1;
+static int distance[MAX_NODES][MAX_NODES];
+static int numaPolicy = NUMA_LOCAL;
+static int preferredNode = 0;
+static int count_local_acc = 0;
+static int count_remote_acc = 0;
+static int count_cow = 0;
+static int count_shared_map = 0;
+static int frames_saved = 0;
+static int peak_frames_saved = 0;
+static int hugeMode = HUGE_NEVER;
+static TLB *tlb;
+static unsigned long long nxt_scan = 0;
+static int scanCursor = 0;	/* Nxt region the collapse scan looks at, over all processes */
+static int count_huge_fault = 0;
+static int count_collapse = 0;
+static int count_collapse_fail = 0;
+static int count_split = 0;
+static double frag_sum = 0;
+static int frag_samples = 0;
+static int threads = 1;	/* Worker threads, 1 for the serial simulation */
+static Worker workers[MAX_THREADS];
+static Node shards[MAX_THREADS];	/* Frame range each worker allocates from first */
+static pthread_mutex_t shardLock[MAX_THREADS];
+static pthread_mutex_t mmLock = PTHREAD_MUTEX_INITIALIZER;	/* Guards the LRU stack and the frame table */
+static pthread_barrier_t roundStart;
+static pthread_barrier_t roundEnd;
+static int *roundIds;	/* Processes in the current round */
+static bool *roundExited;
+static int roundCount = 0;
+static bool workersDone = false;
+static __thread Worker *self = NULL;	/* Worker running on this thread, NULL on the main thread */
+static __thread unsigned int *rng = &seed;
+static int count_steal = 0;
+static int count_drain = 0;
+static unsigned long long tot_acc_time = 0;
+static int zswapFrames = 0;	/* Frames backing the compressed tier, taken off the last node */
+static int zswapCapacity = 0;	/* Compressed pages the tier holds */
+static double zswapRatio = ZSWAP_RATIO;
+static int zswapCompress = ZSWAP_COMPRESS_US;
+static int zswapDecompress = ZSWAP_DECOMPRESS_US;
+static List *zswap;	/* Compressed pages, oldest first */
+static int zswapStored = 0;
+static int peak_zswap_stored = 0;
+static int count_zswap_store = 0;
+static int count_zswap_hit = 0;
+static int count_zswap_writeback = 0;
+static int slowNode = -1;	/* CPU-less node forming the slow tier, -1 without tiering */
+static unsigned long long nxt_tier_scan = 0;
+static int policy = POLICY_LRU;	/* Page replacement policy */
+static unsigned long long agePeriod = AGING_TICK;
+static unsigned long long nxt_age = 0;
+static uint8_t ages[MAX_FRAMES];	/* Aging counter of every frame, kept contiguous for the vector kernels */
+static uint32_t frameRef[BITMAP_WORDS(MAX_FRAMES)];	/* Frames referenced since the last aging tick */
+static int count_age_tick = 0;
+static uint32_t clockRef[BITMAP_WORDS(MAX_FRAMES)];	/* Frames referenced since the clock hand last passed them */
+static int clockHand = 0;
+static bool dueling = false;	/* Whether shadow policies pick the live one */
+static Shadow *shadows[POLICY_ADAPTIVE];	/* Shadow of every live policy, by policy */
+static int duelRefs = 0;	/* Sampled references in the current window */
+static int policyRefs[POLICY_ADAPTIVE];	/* References served under each live policy */
+static int count_policy_switch = 0;
+static const char *policyNames[POLICY_ADAPTIVE] = { "LRU", "aging", "clock" };
+static char *profPath = NULL;	/* Where to write the time breakdown as JSON */
+static char *metricsPath = NULL;	/* Where to write the headline numbers as JSON */
+static char *tracePath = NULL;
+static int traceFormat = TRACE_AUTO;
+static Trace trace;
+static Cache *caches[MAX_CACHES];	/* L1 first, the last one is the LLC */
+static int cacheCount = 0;
+static const int cacheNs[MAX_CACHES] = { CACHE_L1_NS, CACHE_L2_NS, CACHE_LLC_NS };
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static int count_cache_acc = 0;
+static unsigned long long cache_ns = 0;	/* Time the cache hierarchy took over every access */
+static int count_fast_acc = 0;
+static int count_slow_acc = 0;
+static int count_promote = 0;
+static int count_demote = 0;
+static int wmarkMin = 0;	/* Free frames at or below which faults reclaim directly, 0 without watermarks */
+static int wmarkLow = 0;	/* Free frames below which the background reclaimer wakes */
+static int wmarkHigh = 0;	/* Free frames at which the background reclaimer goes back to sleep */
+static bool kswapdAwake = false;
+static unsigned long long nxt_kswapd = 0;
+static int count_free_alloc = 0;
+static int count_direct_reclaim = 0;
+static int count_kswapd_wake = 0;
+static int count_kswapd_reclaim = 0;
+static unsigned long long wssInterval = 0;	/* Simulated ns between working-set samples, 0 without sampling */
+static int wssRegions = WSS_REGIONS;
+static unsigned long long nxt_wss = 0;
+static int count_wss_pass = 0;
+static double wss_sum = 0;	/* Sum of the per-process estimates, for their average */
+static int wss_samples = 0;
+static int peak_wss = 0;	/* Largest sum of the estimates in one pass */
+static double wss_hot = 0;	/* Resident pages of sampled regions found accessed, and found idle */
+static double wss_cold = 0;
+static int loadHigh = 0;	/* Fault percentage above which load control suspends processes, 0 without it */
+static int loadLow = 0;	/* Fault percentage below which it resumes them */
+static Que *suspended;	/* Processes swapped out by load control, oldest first */
+static unsigned long long nxt_load = 0;
+static unsigned long long load_start = 0;	/* Simulated ns the current load interval started at */
+static int load_refs = 0;	/* Access and fault counts the current load interval started at */
+static int load_faults = 0;
+static int count_suspend = 0;
+static int count_resume = 0;
+static unsigned long long thrash_ns = 0;	/* Time and references of intervals that thrashed with every process running */
+static int thrash_refs = 0;
+static unsigned long long held_ns = 0;	/* Time and references of intervals with processes held back */
+static int held_refs = 0;
+static int refBudget = REFERENCE_BUDGET;	/* References each process makes */
+static int warmup = 0;	/* References at the start left out of the statistics */
+static bool warm = false;	/* Whether the warm-up is over */
+static int warm_refs = 0;	/* References the warm-up made before the statistics were reset */
+static unsigned long long warm_ns = 0;	/* Simulated time the warm-up ended at, taken off the run time */
+static int runRefs = 0;	/* References after the warm-up the run ends at, 0 for no limit */
+static unsigned long long runNs = 0;	/* Simulated ns after the warm-up the run ends at, 0 for no limit */
+static bool runOver = false;
 
 int main(int argc, char *argv[])
 {
 	init(argc, argv);
 
-	srand(time(NULL) ^ getpid());
+	seed = time(NULL) ^ getpid();
 
 	bool ok = true;
+	char *nodeArg = NULL;
+	char *distArg = NULL;
+	int zswapPercent = 0;
+	int slowPercent = 0;
+	int slowDistance = TIER_SLOW_DISTANCE;
+	char *end;
 
 	/* Get program arguments */
 	while (true)
 	{
-		int c = getopt(argc, argv, "hm:d");
+		int c = getopt(argc, argv, "hm:dDFc:C:r:S:H:N:L:P:T:Z:M:K:R:t:j:p:W:s:o:l:w:b:e:n:u:");
 		if (c == -1)
 			break;
 		switch (c)
@@ -110,11 +339,349 @@ int main(int argc, char *argv[])
 		case 'd':
 			debug = true;
 			break;
+		case 'F':
+			pooled = true;
+			break;
+		case 'D':
+			debug = true;
+			debugDiff = true;
+			break;
+		case 'c':
+			ckptPath = optarg;
+			break;
+		case 'C':
+			ckptEvery = atoi(optarg);
+			if (!isdigit(*optarg) || ckptEvery == 0)
+			{
+				error("invalid checkpoint interval '%s'", optarg);
+				ok = false;
+			}
+			break;
+		case 'r':
+			restorePath = optarg;
+			break;
+		case 'S':
+			sharedPages = atoi(optarg);
+			if (!isdigit(*optarg) || sharedPages > MAX_PAGES)
+			{
+				error("invalid shared segment size '%s'", optarg);
+				ok = false;
+			}
+			break;
+		case 'H':
+			hugeMode = atoi(optarg);
+			if (!isdigit(*optarg) || (hugeMode < HUGE_ALWAYS || hugeMode > HUGE_DEFER))
+			{
+				error("invalid huge page mode '%s'", optarg);
+				ok = false;
+			}
+			break;
+		case 'N':
+			nodeArg = optarg;
+			break;
+		case 'L':
+			distArg = optarg;
+			break;
+		case 'P':
+			numaPolicy = strtol(optarg, &end, 10) - 1;
+			/* Only the preferred policy takes a node */
+			if (*end == ':' && numaPolicy == NUMA_PREFERRED && isdigit(end[1]))
+				preferredNode = strtol(end + 1, &end, 10);
+			if (!isdigit(*optarg) || *end != '\0' || (numaPolicy < NUMA_LOCAL || numaPolicy > NUMA_PREFERRED))
+			{
+				error("invalid allocation policy '%s'", optarg);
+				ok = false;
+			}
+			break;
+		case 'p':
+			procMax = strtol(optarg, &end, 10);
+			if (*end == ':')
+				procTotal = strtol(end + 1, &end, 10);
+			if (!isdigit(*optarg) || *end != '\0' || procMax < 1 || procTotal < 1)
+			{
+				error("invalid process limits '%s'", optarg);
+				ok = false;
+			}
+			break;
+		case 'W':
+			wmarkMin = strtol(optarg, &end, 10);
+			if (*end == ':')
+			{
+				wmarkLow = strtol(end + 1, &end, 10);
+				if (*end == ':')
+					wmarkHigh = strtol(end + 1, &end, 10);
+				else
+					wmarkHigh = -1;
+			}
+			else
+			{
+				/* Spaced like the kernel's, a quarter and a half of min above it */
+				wmarkLow = wmarkMin + (wmarkMin / 4 > 1 ? wmarkMin / 4 : 1);
+				wmarkHigh = wmarkMin + (wmarkMin / 2 > 2 ? wmarkMin / 2 : 2);
+			}
+			if (!isdigit(*optarg) || *end != '\0' || wmarkMin < 1 || wmarkLow <= wmarkMin || wmarkHigh <= wmarkLow)
+			{
+				error("invalid watermarks '%s'", optarg);
+				ok = false;
+				wmarkMin = 0;
+			}
+			break;
+		case 'T':
+			threads = atoi(optarg);
+			if (!isdigit(*optarg) || threads < 1 || threads > MAX_THREADS)
+			{
+				error("invalid thread count '%s'", optarg);
+				ok = false;
+				threads = 1;
+			}
+			break;
+		case 'Z':
+			zswapPercent = strtol(optarg, &end, 10);
+			if (*end == ':')
+				zswapRatio = strtod(end + 1, &end);
+			if (*end == ':')
+			{
+				/* Latencies come as a pair */
+				zswapCompress = strtol(end + 1, &end, 10);
+				zswapDecompress = (*end == ':') ? strtol(end + 1, &end, 10) : -1;
+			}
+			if (!isdigit(*optarg) || *end != '\0' || zswapPercent <= 0 || zswapPercent >= 100 || zswapRatio < 1 || zswapCompress < 0 || zswapDecompress < 0)
+			{
+				error("invalid compressed tier '%s'", optarg);
+				ok = false;
+				zswapPercent = 0;
+			}
+			break;
+		case 'M':
+			slowPercent = strtol(optarg, &end, 10);
+			if (*end == ':')
+				slowDistance = strtol(end + 1, &end, 10);
+			if (!isdigit(*optarg) || *end != '\0' || slowPercent <= 0 || slowPercent >= 100 || slowDistance <= 0)
+			{
+				error("invalid slow tier '%s'", optarg);
+				ok = false;
+				slowPercent = 0;
+			}
+			break;
+		case 'R':
+			policy = atoi(optarg) - 1;
+			if ((policy == POLICY_AGING || policy == POLICY_ADAPTIVE) && strchr(optarg, ':') != NULL)
+				agePeriod = atoi(strchr(optarg, ':') + 1) * 1000000ULL;
+			if (!isdigit(*optarg) || (policy < POLICY_LRU || policy > POLICY_ADAPTIVE) || agePeriod == 0)
+			{
+				error("invalid replacement policy '%s'", optarg);
+				ok = false;
+			}
+
+			/* Adaptive starts out on LRU, until the shadows have seen a window */
+			dueling = policy == POLICY_ADAPTIVE;
+			if (dueling)
+				policy = POLICY_LRU;
+			break;
+		case 't':
+			tracePath = optarg;
+			if (strncmp(optarg, "lackey:", 7) == 0)
+				traceFormat = TRACE_LACKEY;
+			else if (strncmp(optarg, "csv:", 4) == 0)
+				traceFormat = TRACE_CSV;
+			else if (strncmp(optarg, "bin:", 4) == 0)
+				traceFormat = TRACE_BINARY;
+			if (traceFormat != TRACE_AUTO)
+				tracePath = strchr(optarg, ':') + 1;
+			break;
+		case 'j':
+			profPath = optarg;
+			break;
+		case 'o':
+			metricsPath = optarg;
+			break;
+		case 'w':
+			wssInterval = strtol(optarg, &end, 10);
+			wssRegions = (*end == ':') ? strtol(end + 1, &end, 10) : WSS_REGIONS;
+			if (!isdigit(*optarg) || *end != '\0' || wssInterval < 1 || wssRegions < 1 || wssRegions > MAX_PAGES)
+			{
+				error("invalid working-set sampling '%s'", optarg);
+				ok = false;
+				wssInterval = 0;
+			}
+			wssInterval *= 1000000;
+			break;
+		case 'b':
+			refBudget = strtol(optarg, &end, 10);
+			if (!isdigit(*optarg) || *end != '\0' || refBudget < 1)
+			{
+				error("invalid reference budget '%s'", optarg);
+				ok = false;
+			}
+			break;
+		case 'e':
+			runNs = strtoull(optarg, &end, 10) * 1000000;
+			if (!isdigit(*optarg) || *end != '\0' || runNs == 0)
+			{
+				error("invalid simulated run length '%s'", optarg);
+				ok = false;
+			}
+			break;
+		case 'n':
+			runRefs = strtol(optarg, &end, 10);
+			if (!isdigit(*optarg) || *end != '\0' || runRefs < 1)
+			{
+				error("invalid reference count '%s'", optarg);
+				ok = false;
+			}
+			break;
+		case 'u':
+			warmup = strtol(optarg, &end, 10);
+			if (!isdigit(*optarg) || *end != '\0' || warmup < 0)
+			{
+				error("invalid warm-up '%s'", optarg);
+				ok = false;
+			}
+			break;
+		case 'l':
+			loadHigh = strtol(optarg, &end, 10);
+			loadLow = (*end == ':') ? strtol(end + 1, &end, 10) : loadHigh / 2;
+			if (!isdigit(*optarg) || *end != '\0' || loadHigh < 1 || loadHigh > 100 || loadLow < 0 || loadLow >= loadHigh)
+			{
+				error("invalid load control thresholds '%s'", optarg);
+				ok = false;
+				loadHigh = 0;
+			}
+			break;
+		case 's':
+			seed = strtoul(optarg, &end, 10);
+			if (!isdigit(*optarg) || *end != '\0')
+			{
+				error("invalid seed '%s'", optarg);
+				ok = false;
+			}
+			break;
+		case 'K':
+			if ((cacheCount = parseCaches(optarg)) <= 0)
+			{
+				error("invalid cache levels '%s'", optarg);
+				ok = false;
+				cacheCount = 0;
+			}
+			break;
 		default:
 			ok = false;
 		}
 	}
 
+	/* Lay the nodes out one after another in the frame space */
+	int sizes[MAX_NODES] = { MAX_FRAMES };
+	if (nodeArg != NULL && (nodeCount = parseInts(nodeArg, sizes, MAX_NODES)) <= 0)
+	{
+		error("invalid node sizes '%s'", nodeArg);
+		ok = false;
+		nodeCount = 1;
+	}
+	frameCount = 0;
+	int i, j;
+	for (i = 0; i < nodeCount; i++)
+	{
+		nodes[i].base = frameCount;
+		nodes[i].size = sizes[i];
+		nodes[i].cursor = 0;
+		frameCount += sizes[i];
+		if (sizes[i] <= 0 || frameCount > MAX_FRAMES)
+		{
+			error("node sizes '%s' must be positive and add up to at most %d frames", nodeArg, MAX_FRAMES);
+			ok = false;
+			break;
+		}
+	}
+
+	/* The compressed tier is carved out of the last node */
+	if (zswapPercent > 0)
+	{
+		zswapFrames = frameCount * zswapPercent / 100;
+		zswapCapacity = zswapFrames * zswapRatio;
+		nodes[nodeCount - 1].size -= zswapFrames;
+		frameCount -= zswapFrames;
+		if (zswapFrames == 0 || nodes[nodeCount - 1].size <= 0)
+		{
+			error("compressed tier of %d%% leaves no frames on node %d", zswapPercent, nodeCount - 1);
+			ok = false;
+		}
+	}
+
+	/* Distances default to local and remote, or come row by row from -L */
+	int dists[MAX_NODES * MAX_NODES];
+	if (distArg != NULL && parseInts(distArg, dists, MAX_NODES * MAX_NODES) != nodeCount * nodeCount)
+	{
+		error("invalid distance matrix '%s', expected %d values", distArg, nodeCount * nodeCount);
+		ok = false;
+	}
+	for (i = 0; i < nodeCount; i++)
+		for (j = 0; j < nodeCount; j++)
+		{
+			if (distArg != NULL)
+				distance[i][j] = dists[i * nodeCount + j];
+			else
+				distance[i][j] = (i == j) ? NUMA_LOCAL_DISTANCE : NUMA_REMOTE_DISTANCE;
+			if (distance[i][j] <= 0)
+			{
+				error("node distances must be positive");
+				ok = false;
+			}
+		}
+
+	/* The slow tier is one more node, without CPUs, carved out of the last one */
+	if (slowPercent > 0 && nodeCount == MAX_NODES)
+	{
+		error("no node left for the slow tier");
+		ok = false;
+	}
+	else if (slowPercent > 0)
+	{
+		Node *last = &nodes[nodeCount - 1];
+		slowNode = nodeCount++;
+		nodes[slowNode].size = frameCount * slowPercent / 100;
+		nodes[slowNode].base = last->base + last->size - nodes[slowNode].size;
+		nodes[slowNode].cursor = 0;
+		last->size -= nodes[slowNode].size;
+		if (nodes[slowNode].size == 0 || last->size <= 0)
+		{
+			error("slow tier of %d%% leaves no frames on node %d", slowPercent, slowNode - 1);
+			ok = false;
+		}
+		for (i = 0; i <= slowNode; i++)
+		{
+			distance[i][slowNode] = (i == slowNode) ? NUMA_LOCAL_DISTANCE : slowDistance;
+			distance[slowNode][i] = distance[i][slowNode];
+		}
+	}
+	if (wmarkHigh >= frameCount)
+	{
+		error("high watermark %d is not below the %d frames", wmarkHigh, frameCount);
+		ok = false;
+	}
+	if (preferredNode < 0 || preferredNode >= nodeCount)
+	{
+		error("preferred node %d does not exist", preferredNode);
+		ok = false;
+	}
+
+	/* Parallel mode covers plain paging on a single node */
+	if (threads > 1 && (debug || sharedPages > 0 || hugeMode != HUGE_NEVER || nodeCount > 1 || zswapFrames > 0 || policy != POLICY_LRU || dueling || wmarkMin > 0 || loadHigh > 0))
+	{
+		error("-T cannot be combined with -d, -D, -S, -H, -N, -Z, -M, -R, -W or -l");
+		ok = false;
+	}
+	/* A trace changes a page between reading and writing, which a read-only shared mapping cannot follow */
+	if (tracePath != NULL && (threads > 1 || ckptEvery > 0 || restorePath != NULL || sharedPages > 0))
+	{
+		error("-t cannot be combined with -T, -C, -r or -S");
+		ok = false;
+	}
+	if (threads > 1 && frameCount / threads < 8)
+	{
+		error("too few frames for %d shards", threads);
+		ok = false;
+	}
+
 	/* Check for unknown arguments */
 	if (optind < argc)
 	{
@@ -133,6 +700,16 @@ int main(int argc, char *argv[])
 	if (!ok)
 		usage(EXIT_FAILURE);
 
+	/* Each shadow holds as many pages as the sampled share of memory; a restore reads them from the checkpoint instead */
+	for (i = 0; dueling && restorePath == NULL && i < POLICY_ADAPTIVE; i++)
+		shadows[i] = newShadow(i, (frameCount / DUEL_SAMPLE > 0) ? frameCount / DUEL_SAMPLE : 1, agePeriod);
+
+	if (tracePath != NULL && !traceOpen(&trace, tracePath, traceFormat))
+	{
+		error("cannot read trace '%s'", tracePath);
+		exit(EXIT_FAILURE);
+	}
+
 	registerSgHandler();
 
 	/* Clear log file */
@@ -144,20 +721,59 @@ int main(int argc, char *argv[])
 
 	/* Setup simulation */
 	init_IPC();
-	memset(pids, 0, sizeof(pids));
 	sys->clock.s = 0;
 	sys->clock.ns = 0;
 	nxt_spawn.s = 0;
 	nxt_spawn.ns = 0;
 	sysInit();
 	que = newQueue();
-	rfrnce = newList();
+	suspended = newQueue();
 	stack = newList();
+	tlb = newTLB(TLB_ENTRIES);
+	zswap = newList();
+	dumpInit(&dump, logWrite);
+	if (restorePath != NULL)
+		restoreCheckpoint();
+	if (pooled && tracePath == NULL)
+		startPool(procMax);
+	nxt_ckpt = sys->clock.s + ckptEvery;
 
 	/* Start simulating */
-	simulation();
+	if (threads > 1)
+		startWorkers();
+	profStart();
+	if (tracePath != NULL)
+	{
+		replayTrace();
+		traceClose(&trace);
+	}
+	else
+		simulation();
+	if (threads > 1)
+		stopWorkers();
+	profStop();
+	if (interrupted || runOver)
+		stopUsers();
+	if (pooled)
+		stopPool();
 
 	showSummary();
+	if (profPath != NULL)
+	{
+		FILE *fp = fopen(profPath, "w");
+		if (fp == NULL)
+			crash("fopen");
+		profJson(fp, threads);
+		fclose(fp);
+	}
+	if (metricsPath != NULL)
+	{
+		FILE *fp = fopen(metricsPath, "w");
+		if (fp == NULL)
+			crash("fopen");
+		writeMetrics(fp);
+		fclose(fp);
+	}
 
 	/* Cleanup resources */
 	free_IPC();
@@ -165,9 +781,195 @@ int main(int argc, char *argv[])
 	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
+/* Runs the background scanners whose interval has passed */
+void backgroundScans()
+{
+	/* Let the background scanner collapse regions into huge pages */
+	if (hugeMode != HUGE_NEVER && clockNs() >= nxt_scan)
+	{
+		collapseScan();
+		nxt_scan = clockNs() + HUGE_SCAN_INTERVAL;
+	}
+
+	/* Let the background scanner move pages between the tiers */
+	if (slowNode != -1 && clockNs() >= nxt_tier_scan)
+	{
+		tierScan();
+		nxt_tier_scan = clockNs() + TIER_SCAN_INTERVAL;
+	}
+
+	/* Let the background reclaimer keep free frames above the low watermark */
+	if (wmarkMin > 0 && clockNs() >= nxt_kswapd)
+	{
+		kswapd();
+		nxt_kswapd = clockNs() + KSWAPD_INTERVAL;
+	}
+
+	/* Let the working-set sampler see which watched pages were accessed */
+	if (wssInterval > 0 && clockNs() >= nxt_wss)
+	{
+		wssScan();
+		nxt_wss = clockNs() + wssInterval;
+	}
+}
+
+/* Trace driver, replaying references from a file in place of user processes */
+void replayTrace()
+{
+	TraceRef ref;
+	int polls = 0;
+	int i;
+
+	while (!quit && !checkRunLength() && traceNext(&trace, &ref))
+	{
+		/* Fold the address into the simulated address space, keeping its offset in the page */
+		int proc = ref.proc % procMax;
+		unsigned int reqPg = (ref.addr / PAGE_SIZE) % MAX_PAGES;
+		unsigned int reqAddr = (reqPg << 10) + ref.addr % PAGE_SIZE;
+
+		/* A process is set up the first time the trace mentions it; traced processes have no PID */
+		if (traceIds[proc] == -1)
+		{
+			traceIds[proc] = find_avail_PID();
+			init_PCB(-1, traceIds[proc], 0);
+			act_count++;
+			spawn_count++;
+			flog("p%d created from the trace\n", traceIds[proc]);
+		}
+		int sp_id = traceIds[proc];
+
+		clckAvance(0);
+		pcbOf(pcbs, sp_id)->p_table[reqPg].protec = ref.write;
+		handleReference(sp_id, reqAddr, reqPg);
+		showMemoryMap();
+		backgroundScans();
+		if (++polls % EVENT_POLL_EVERY == 0)
+			pollEvents(false);
+	}
+
+	for (i = 0; i < procMax; i++)
+		if (traceIds[i] != -1)
+		{
+			flog("P%d has reached the end of the trace, freeing memory\n", traceIds[i]);
+			releasePages(traceIds[i]);
+			pcbFree(pcbs, traceIds[i]);
+			traceIds[i] = -1;
+			act_count--;
+			exit_count++;
+		}
+}
+
 /* Simulation driver */
+/* Ends the warm-up once it has made its references, and the run once what came after has reached a limit */
+bool checkRunLength()
+{
+	if (!warm && count_mem_acc >= warmup)
+	{
+		warm = true;
+		warm_refs = count_mem_acc;
+		warm_ns = clockNs();
+		if (warmup > 0)
+		{
+			flog("Warm-up over after %d references\n", count_mem_acc);
+			resetStats();
+		}
+	}
+	if (warm && !runOver && ((runRefs > 0 && count_mem_acc >= runRefs) || (runNs > 0 && clockNs() - warm_ns >= runNs)))
+	{
+		runOver = quit = true;
+		flog("Run length reached after %d references\n", count_mem_acc);
+	}
+	return runOver;
+}
+
+/* Zeroes every statistic the summary reports, so that it covers only what comes after the warm-up */
+void resetStats()
+{
+	int i;
+
+	/* Load control measures intervals as differences of the counters, so they keep their place */
+	load_refs -= count_mem_acc;
+	load_faults -= count_pg_fault;
+	count_mem_acc = 0;
+	count_pg_fault = 0;
+	tot_acc_time = 0;
+	count_local_acc = 0;
+	count_remote_acc = 0;
+	count_fast_acc = 0;
+	count_slow_acc = 0;
+	count_promote = 0;
+	count_demote = 0;
+	count_cow = 0;
+	count_shared_map = 0;
+	peak_frames_saved = frames_saved;
+	count_huge_fault = 0;
+	count_collapse = 0;
+	count_collapse_fail = 0;
+	count_split = 0;
+	frag_sum = 0;
+	frag_samples = 0;
+	count_steal = 0;
+	count_drain = 0;
+	count_zswap_store = 0;
+	count_zswap_hit = 0;
+	count_zswap_writeback = 0;
+	peak_zswap_stored = zswapStored;
+	count_age_tick = 0;
+	count_policy_switch = 0;
+	memset(policyRefs, 0, sizeof(policyRefs));
+	for (i = 0; dueling && i < POLICY_ADAPTIVE; i++)
+	{
+		shadows[i]->hits = 0;
+		shadows[i]->misses = 0;
+	}
+	count_cache_acc = 0;
+	cache_ns = 0;
+	for (i = 0; i < cacheCount; i++)
+	{
+		caches[i]->hits = 0;
+		caches[i]->misses = 0;
+	}
+	tlb->hits = 0;
+	tlb->misses = 0;
+	tlb->reachSum = 0;
+	for (i = 0; threads > 1 && i < threads; i++)
+	{
+		workers[i].tlb->hits = 0;
+		workers[i].tlb->misses = 0;
+		workers[i].tlb->reachSum = 0;
+	}
+	count_free_alloc = 0;
+	count_direct_reclaim = 0;
+	count_kswapd_wake = 0;
+	count_kswapd_reclaim = 0;
+	count_wss_pass = 0;
+	wss_sum = 0;
+	wss_samples = 0;
+	peak_wss = 0;
+	wss_hot = 0;
+	wss_cold = 0;
+	count_suspend = 0;
+	count_resume = 0;
+	thrash_ns = 0;
+	thrash_refs = 0;
+	held_ns = 0;
+	held_refs = 0;
+	count_pool_assign = 0;
+	profReset();
+}
+
+/* True when oss has nothing to do but wait for user processes to exit */
+bool isIdle()
+{
+	if (!isQueueEmpty(que) || !isQueueEmpty(suspended) || act_count == 0)
+		return false;
+	return quit || spawn_count >= procTotal || act_count >= procMax;
+}
+
 void simulation()
 {
+	int polls = 0;
+
 	/* Simulate run loop */
 	while (true)
 	{
@@ -176,15 +978,27 @@ void simulation()
 		processesHandler();
 		clckAvance(0);
 
-		/* Catch an exited user process */
-		int status;
-		pid_t p_id = waitpid(-1, &status, WNOHANG);
-		if (p_id > 0)
+		/* Look for signals while a user process is on its way out, otherwise only every so often; sleep when only exits are left */
+		if (act_count > sizeOfQueue(que) + sizeOfQueue(suspended) || ++polls % EVENT_POLL_EVERY == 0)
+			pollEvents(isIdle());
+		if (interrupted || runOver)
+			break;
+
+		backgroundScans();
+
+		/* Let load control hold processes back while the system thrashes */
+		if (loadHigh > 0 && clockNs() >= nxt_load)
 		{
-			int sp_id = WEXITSTATUS(status);
-			pids[sp_id] = 0;
-			act_count--;
-			exit_count++;
+			loadControl();
+			nxt_load = clockNs() + LOAD_INTERVAL;
+		}
+
+		/* Snapshot the simulation when asked to, or when the interval has passed */
+		if (ckptPending || (ckptEvery > 0 && sys->clock.s >= nxt_ckpt))
+		{
+			saveCheckpoint();
+			ckptPending = false;
+			nxt_ckpt = sys->clock.s + ckptEvery;
 		}
 
 		/* Stop simulating if the last user process has exited */
@@ -195,260 +1009,1527 @@ void simulation()
 		}
 		else
 		{
-			if (exit_count == PROCESSES_TOTAL)
-				break;
+			if (exit_count == procTotal)
+				break;
+		}
+	}
+}
+void spawnTheProcess(int sp_id)
+{
+	profEnter(PHASE_SPAWN);
+
+	/* Fork a new user process with a fresh generator state */
+	unsigned int userSeed = rand_r(&seed);
+	pid_t p_id = startUser(sp_id, userSeed, 0);
+
+	/* Since parent, initialize the new user process for simulation */
+	init_PCB(p_id, sp_id, userSeed);
+	enqueue(que, sp_id);
+	act_count++;
+	spawn_count++;
+
+	flog("p%d created\n", sp_id);
+	profLeave();
+}
+/* Forks and executes a user process that starts from the given generator state */
+pid_t forkUser(int sp_id, unsigned int userSeed, int refs)
+{
+	pid_t p_id = fork();
+
+	if (p_id == -1)
+		crash("fork");
+	else if (p_id == 0)
+	{
+		/* Since child, execute a new user process */
+		char arg0[BUFFER_LENGTH];
+		char arg1[BUFFER_LENGTH];
+		char arg2[BUFFER_LENGTH];
+		char arg3[BUFFER_LENGTH];
+		char arg4[BUFFER_LENGTH];
+		sprintf(arg0, "%d", sp_id);
+		sprintf(arg1, "%d", schm);
+		sprintf(arg2, "%u", userSeed);
+		sprintf(arg3, "%d", refs);
+		sprintf(arg4, "%d", refBudget);
+
+		/* Interrupts are for oss, which ends its user processes itself */
+		signal(SIGINT, SIG_IGN);
+		sigprocmask(SIG_SETMASK, &userMask, NULL);
+		if (sp_id == -1)
+			execl("./user", "user", "pool", (char *)NULL);
+		else
+			execl("./user", "user", arg0, arg1, arg2, arg3, arg4, (char *)NULL);
+		crash("execl");
+	}
+
+	/* Record its PID, so its exit can be matched back to it */
+	if (sp_id != -1)
+		pcbSetPid(pcbs, sp_id, p_id);
+	return p_id;
+}
+
+/* Starts a user process for a simulated one; in pool mode an idle worker takes on its identity instead */
+pid_t startUser(int sp_id, unsigned int userSeed, int refs)
+{
+	Message msg;
+
+	if (!pooled)
+		return forkUser(sp_id, userSeed, refs);
+
+	/* The pool grows when every worker is busy, as when restoring a checkpoint before it started */
+	if (idleCount == 0)
+		startPool((poolSize < procMax) ? procMax : poolSize + 1);
+
+	pid_t p_id = idleWorkers[--idleCount];
+	msg.type = p_id;
+	msg.kind = MSG_ASSIGN;
+	msg.p_id = p_id;
+	msg.sp_id = sp_id;
+	msg.schm = schm;
+	msg.seed = userSeed;
+	msg.refs = refs;
+	msg.budget = refBudget;
+	while (msgsnd(msq_id, &msg, sizeof(Message) - sizeof(long), 0) == -1)
+		if (errno != EINTR)
+			crash("msgsnd");
+
+	pcbSetPid(pcbs, sp_id, p_id);
+	count_pool_assign++;
+	return p_id;
+}
+
+/* Forks idle pool workers until there are size workers in all */
+void startPool(int size)
+{
+	if (size <= poolSize)
+		return;
+
+	idleWorkers = (pid_t*) realloc(idleWorkers, size * sizeof(pid_t));
+	if (idleWorkers == NULL)
+		crash("realloc");
+	while (poolSize < size)
+	{
+		idleWorkers[idleCount++] = forkUser(-1, 0, 0);
+		poolSize++;
+	}
+}
+
+/* Tells every pool worker to exit, then reaps them; every worker is idle once the simulation is over */
+void stopPool()
+{
+	Message msg;
+	int i;
+
+	for (i = 0; i < idleCount; i++)
+	{
+		msg.type = idleWorkers[i];
+		msg.kind = MSG_RETIRE;
+		msg.p_id = idleWorkers[i];
+		while (msgsnd(msq_id, &msg, sizeof(Message) - sizeof(long), 0) == -1)
+			if (errno != EINTR)
+				crash("msgsnd");
+	}
+	for (i = 0; i < idleCount; i++)
+		while (waitpid(idleWorkers[i], NULL, 0) == -1 && errno == EINTR)
+			;
+	idleCount = 0;
+}
+
+/* Hands the worker of a terminated simulated process back to the pool, counting the process as exited */
+void retireUser(int sp_id)
+{
+	idleWorkers[idleCount++] = pcbOf(pcbs, sp_id)->p_id;
+	pcbFree(pcbs, sp_id);
+	act_count--;
+	exit_count++;
+}
+
+void flog(char *fmt, ...)
+{
+	profEnter(PHASE_LOG);
+	FILE *fp = fopen(PATH_LOG, "a+");
+	if (fp == NULL)
+		crash("fopen");
+
+	char buf[BUFFER_LENGTH];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buf, BUFFER_LENGTH, fmt, args);
+	va_end(args);
+
+	char buff[BUFFER_LENGTH];
+	snprintf(buff, BUFFER_LENGTH, "%s[%d.%d] %s", basename(prgName), sys->clock.s, sys->clock.ns, buf);
+
+	fprintf(stderr, buff);
+	fprintf(fp, buff);
+
+	fclose(fp);
+	profLeave();
+}
+/* Sends and receives messages from user processes, and acts upon them */
+void processesHandler()
+{
+	QueNode *nxt = que->frnt;
+	Que *temp = newQueue();
+	int i;
+
+	if (threads > 1)
+	{
+		/* Hand the round to the workers, each taking the processes in its partition */
+		roundCount = 0;
+		for (; nxt != NULL; nxt = nxt->nxt)
+			roundIds[roundCount++] = nxt->indx;
+		pthread_barrier_wait(&roundStart);
+		pthread_barrier_wait(&roundEnd);
+
+		for (i = 0; i < roundCount; i++)
+			if (!roundExited[i])
+				enqueue(temp, roundIds[i]);
+			else if (pooled)
+				retireUser(roundIds[i]);
+		checkRunLength();
+	}
+	else
+	{
+		/* While we have user processes to simulate */
+		while (nxt != NULL)
+		{
+			if (checkRunLength())
+				enqueue(temp, nxt->indx);
+			else if (handleProcess(nxt->indx))
+				enqueue(temp, nxt->indx);
+			else if (pooled)
+				retireUser(nxt->indx);
+
+			/* On to the nxt user process to simulate */
+			nxt = (nxt->nxt != NULL) ? nxt->nxt : NULL;
+		}
+	}
+
+	/* Reset the current queue */
+	while (!isQueueEmpty(que))
+		dequeue(que);
+	while (!isQueueEmpty(temp))
+	{
+		i = temp->frnt->indx;
+		enqueue(que, i);
+		dequeue(temp);
+	}
+
+	free(temp);
+}
+
+/* Lets one user process make its nxt reference; returns false once it has terminated */
+bool handleProcess(int sp_id)
+{
+	Message msg;
+	bool running = true;
+
+	clckAvance(0);
+
+	/* Send a msg to a user process saying it's your turn to "run" */
+	msg.type = pcbOf(pcbs, sp_id)->p_id;
+	msg.kind = MSG_RUN;
+	msg.sp_id = sp_id;
+	msg.p_id = pcbOf(pcbs, sp_id)->p_id;
+	msg.terminate = false;
+	msg.reply = (self != NULL) ? MSG_REPLY_WORKER + self->id : MSG_REPLY;
+	profEnter(PHASE_IPC);
+	while (msgsnd(msq_id, &msg, sizeof(Message) - sizeof(long), 0) == -1)
+		if (errno != EINTR)
+			crash("msgsnd");
+
+	/* Receive a response of what they're doing */
+	while (msgrcv(msq_id, &msg, sizeof(Message) - sizeof(long), msg.reply, 0) == -1)
+		if (errno != EINTR)
+			crash("msgrcv");
+	profLeave();
+
+	clckAvance(0);
+
+	lockIf(&pcbOf(pcbs, sp_id)->lock);
+	if (msg.terminate)
+	{
+		showMemoryMap();
+
+		flog("P%d has terminated, freeing memory\n", sp_id);
+
+		releasePages(sp_id);
+		running = false;
+	}
+	else
+	{
+		/* Remember where its generator is, so a checkpoint can resume it */
+		pcbOf(pcbs, sp_id)->seed = msg.seed;
+		pcbOf(pcbs, sp_id)->refs = msg.refs;
+
+		handleReference(sp_id, msg.addr, msg.pg);
+	}
+	unlockIf(&pcbOf(pcbs, sp_id)->lock);
+
+	showMemoryMap();
+
+	return running;
+}
+
+/* Serves one reference of a process: a hit, or a fault that brings the page in */
+void handleReference(int sp_id, unsigned int reqAddr, unsigned int reqPg)
+{
+	PTE *pte = &pcbOf(pcbs, sp_id)->p_table[reqPg];
+
+	if (pte->protec == 0)
+	{
+		flog("Process:%d request reading from the address %d-%d\n", sp_id, reqAddr, reqPg);
+	}
+	else
+	{
+		flog("Process:%d request writing to the address %d-%d\n", sp_id, reqAddr, reqPg);
+	}
+
+	statAdd(count_mem_acc, 1);
+	if (dueling)
+		duel(sp_id, reqPg);
+
+	if (!bitTest(pcbOf(pcbs, sp_id)->valid, reqPg))
+	{
+		handleFault(sp_id, reqAddr, reqPg);
+	}
+	else
+	{
+		// Update LRU stack
+		touchPage(sp_id, reqPg);
+
+		if (pte->protec == 0)
+		{
+			flog("Address %d-%d already in frame %d, giving data to Process:%d\n", reqAddr, reqPg, pte->frm, sp_id);
+		}
+		else
+		{
+			flog("Address %d-%d already in frame %d, writing data to Process:%d\n", reqAddr, reqPg, pte->frm, sp_id);
+			bitSet(pcbOf(pcbs, sp_id)->dirty, reqPg);
+		}
+	}
+
+	/* The access itself costs more the further the frame is from the process' home node */
+	int home = pcbOf(pcbs, sp_id)->node;
+	int node = nodeOf(pte->frm);
+	if (node == home)
+		statAdd(count_local_acc, 1);
+	else
+		statAdd(count_remote_acc, 1);
+	if (node == slowNode)
+		count_slow_acc++;
+	else
+		count_fast_acc++;
+	bitSet(pcbOf(pcbs, sp_id)->referenced, reqPg);
+	bitClear(pcbOf(pcbs, sp_id)->idle, reqPg);
+	if (policy == POLICY_CLOCK || dueling)
+		bitSet(clockRef, pte->frm);
+	if (policy == POLICY_AGING || dueling)
+	{
+		bitSet(frameRef, pte->frm);
+		if (clockNs() >= nxt_age)
+		{
+			ageTick(ages, frameRef, frameCount);
+			count_age_tick++;
+			nxt_age = clockNs() + agePeriod;
+		}
+	}
+	statAdd(tot_acc_time, clckAvance(1000000 / NUMA_LOCAL_DISTANCE * distance[home][node]));
+	if (cacheCount > 0)
+		cacheReference(home, pte->frm, reqAddr, node);
+
+	TLB *cpuTlb = tlbOf(sp_id);
+	lockIf(&workers[sp_id % threads].tlbLock);
+	tlbLookup(cpuTlb, sp_id, reqPg, pte->huge);
+	unlockIf(&workers[sp_id % threads].tlbLock);
+}
+
+/* Starts the worker threads of parallel mode, each with its own shard of the frames */
+void startWorkers()
+{
+	int i;
+	int per = (frameCount / threads) / 8 * 8;
+
+	roundIds = (int*) malloc(procMax * sizeof(int));
+	roundExited = (bool*) malloc(procMax * sizeof(bool));
+	pthread_barrier_init(&roundStart, NULL, threads + 1);
+	pthread_barrier_init(&roundEnd, NULL, threads + 1);
+
+	for (i = 0; i < threads; i++)
+	{
+		Worker *w = &workers[i];
+		w->id = i;
+		w->seed = rand_r(&seed);
+		w->tlb = newTLB(TLB_ENTRIES);
+		w->pvCount = 0;
+		pthread_mutex_init(&w->tlbLock, NULL);
+
+		/* Shards are whole bytes of the bitmap, the last one taking what is left over */
+		shards[i].base = i * per;
+		shards[i].size = (i == threads - 1) ? frameCount - i * per : per;
+		shards[i].cursor = 0;
+		pthread_mutex_init(&shardLock[i], NULL);
+
+		if (pthread_create(&w->thread, NULL, workerMain, w) != 0)
+			crash("pthread_create");
+	}
+}
+
+void stopWorkers()
+{
+	int i;
+
+	workersDone = true;
+	pthread_barrier_wait(&roundStart);
+	for (i = 0; i < threads; i++)
+		pthread_join(workers[i].thread, NULL);
+}
+
+void *workerMain(void *arg)
+{
+	Worker *w = (Worker*) arg;
+	sigset_t mask;
+	int i;
+
+	/* Signals are left to the main thread */
+	sigfillset(&mask);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+	self = w;
+	rng = &w->seed;
+	while (true)
+	{
+		pthread_barrier_wait(&roundStart);
+		if (workersDone)
+			break;
+
+		for (i = 0; i < roundCount; i++)
+			if (roundIds[i] % threads == w->id)
+				roundExited[i] = !handleProcess(roundIds[i]);
+		drainPagevec(w);
+
+		pthread_barrier_wait(&roundEnd);
+	}
+
+	return NULL;
+}
+
+/* Applies a worker's batched LRU updates under one hold of the LRU lock */
+void drainPagevec(Worker *w)
+{
+	int i;
+
+	if (w->pvCount == 0)
+		return;
+
+	profEnter(PHASE_REPLACE);
+	pthread_mutex_lock(&mmLock);
+	for (i = 0; i < w->pvCount; i++)
+	{
+		/* Pages evicted or released since the hit are no longer on the stack, and stay off */
+		if (removeFrmList(stack, w->pvSpid[i], w->pvPg[i], w->pvFrm[i]) != -1)
+			append(stack, w->pvSpid[i], w->pvPg[i], w->pvFrm[i]);
+	}
+	pthread_mutex_unlock(&mmLock);
+
+	w->pvCount = 0;
+	statAdd(count_drain, 1);
+	profLeave();
+}
+
+/* The TLB of the CPU a process runs on */
+TLB *tlbOf(int sp_id)
+{
+	return (threads > 1) ? workers[sp_id % threads].tlb : tlb;
+}
+
+/* Takes a free frame from this worker's shard, or steals one from another shard */
+int allocShardFrame()
+{
+	int k;
+
+	for (k = 0; k < threads; k++)
+	{
+		int s = (self->id + k) % threads;
+		Node *shard = &shards[s];
+
+		pthread_mutex_lock(&shardLock[s]);
+		int frm = takeFrame(shard);
+		pthread_mutex_unlock(&shardLock[s]);
+		if (frm != -1)
+		{
+			if (k > 0)
+				statAdd(count_steal, 1);
+			return frm;
+		}
+	}
+
+	return -1;
+}
+
+void lockIf(pthread_mutex_t *lock)
+{
+	if (threads > 1)
+		pthread_mutex_lock(lock);
+}
+
+void unlockIf(pthread_mutex_t *lock)
+{
+	if (threads > 1)
+		pthread_mutex_unlock(lock);
+}
+
+/* Resolves a page fault, sharing or copying a shared segment page where possible */
+void handleFault(int sp_id, unsigned int reqAddr, unsigned int reqPg)
+{
+	PTE *pte = &pcbOf(pcbs, sp_id)->p_table[reqPg];
+	bool isShared = (int) reqPg < sharedPages;
+	int frm, i;
+
+	profEnter(PHASE_FAULT);
+	flog("Address %d-%d not in the frame, PAGEFAULT Error\n", reqAddr, reqPg);
+
+	if (isShared && sharedFrm[reqPg] != -1 && pte->protec == 0)
+	{
+		/* Another process already brought this page in, so just map its frame */
+		frm = sharedFrm[reqPg];
+		mapFrame(sp_id, reqPg, frm, true);
+		count_shared_map++;
+		flog("Mapped shared frame %d to Process:%d (%d users)\n", frm, sp_id, frames[frm].refs);
+	}
+	else if (isShared && sharedFrm[reqPg] != -1)
+	{
+		/* Writing a shared page, so give this process its own copy */
+		int src = sharedFrm[reqPg];
+		count_cow++;
+		statAdd(count_pg_fault, 1);
+		statAdd(tot_acc_time, clckAvance(COW_COPY_US * 1000 + 1));
+		frm = allocFrame(sp_id, reqAddr, reqPg);
+		mapFrame(sp_id, reqPg, frm, false);
+		cacheInvalidateFrame(frm);
+		flog("Copy-on-write of shared frame %d into frame %d for Process:%d\n", src, frm, sp_id);
+	}
+	else
+	{
+		statAdd(count_pg_fault, 1);
+		if (pte->zswap)
+		{
+			/* Served from the compressed tier instead of the disk */
+			zswapLoad(sp_id, reqPg);
+			statAdd(tot_acc_time, clckAvance(zswapDecompress * 1000 + 1));
+		}
+		else
+			statAdd(tot_acc_time, clckAvance(10 * 1000000));
+
+		int head;
+		if (hugeMode == HUGE_ALWAYS && isHugeCandidate(sp_id, reqPg) && (head = findHugeRun(sp_id, reqPg)) != -1)
+		{
+			/* Fault in the whole aligned region at once */
+			mapHuge(sp_id, reqPg - reqPg % HUGE_PAGE_PAGES, head);
+			frm = pte->frm;
+			for (i = 0; i < HUGE_PAGE_PAGES; i++)
+				cacheInvalidateFrame(head + i);
+			count_huge_fault++;
+			flog("Allocated huge page frames %d-%d to Process:%d\n", head, head + HUGE_PAGE_PAGES - 1, sp_id);
+		}
+		else
+		{
+			frm = allocFrame(sp_id, reqAddr, reqPg);
+			mapFrame(sp_id, reqPg, frm, isShared && pte->protec == 0);
+			cacheInvalidateFrame(frm);
+			flog("Allocated frame %d to Process:%d\n", frm, sp_id);
+		}
+	}
+
+	if (pte->protec == 0)
+	{
+		flog("Address %d-%d in frame %d, giving data to Process:%d\n", reqAddr, reqPg, frm, sp_id);
+		bitClear(pcbOf(pcbs, sp_id)->dirty, reqPg);
+	}
+	else
+	{
+		flog("Address %d-%d in frame %d, writing data to Process:%d\n", reqAddr, reqPg, frm, sp_id);
+		bitSet(pcbOf(pcbs, sp_id)->dirty, reqPg);
+	}
+	profLeave();
+}
+
+/* Returns a free frame, from the nodes the policy prefers, replacing the least recently used page when memory is full */
+int allocFrame(int sp_id, unsigned int reqAddr, unsigned int reqPg)
+{
+	int order[MAX_NODES];
+	int n = nodeOrder(sp_id, reqPg, order);
+	int i, k;
+
+	/* Workers allocate from their own shard first */
+	if (self != NULL && (i = allocShardFrame()) != -1)
+	{
+		statAdd(count_free_alloc, 1);
+		return i;
+	}
+
+	/* Find available frame, as long as free memory is above the min watermark */
+	bool belowMin = wmarkMin > 0 && freeFrameCount() <= wmarkMin;
+	for (k = 0; self == NULL && !belowMin && k < n; k++)
+	{
+		int frm = takeFrame(&nodes[order[k]]);
+		if (frm != -1)
+		{
+			count_free_alloc++;
+			return frm;
+		}
+	}
+
+	/* Handle when memory is full, or so low the fault has to reclaim for itself */
+	profEnter(PHASE_REPLACE);
+	if (belowMin)
+		flog("Address %d-%d not in frame, free memory below the min watermark\n", reqAddr, reqPg);
+	else
+		flog("Address %d-%d not in frame, memory is full\n", reqAddr, reqPg);
+	statAdd(count_direct_reclaim, 1);
+	int frm = evictPage(sp_id);
+
+	/* Keep new pages in the fast tier by demoting its coldest page into the freed slow frame, rather than evicting it */
+	NodeOfList *cold;
+	if (slowNode != -1 && nodeOf(frm) == slowNode && order[0] != slowNode && (cold = coldestPage(false)) != NULL)
+	{
+		int fast = cold->frm;
+		flog("Demoted address %d-%d of Process:%d from frame %d to frame %d\n", cold->pg << 10, cold->pg, cold->indx, fast, frm);
+		movePage(cold, frm, frames[fast].heat);
+		count_demote++;
+		frm = fast;
+	}
+
+	profLeave();
+	return frm;
+}
+
+/* Unmaps the page replacement picks and returns its frame, still marked allocated */
+int evictPage(int sp_id)
+{
+	int i;
+
+	/* Huge pages are split under pressure, leaving their base pages oldest in the stack */
+	while (policy == POLICY_LRU && hugeMode != HUGE_NEVER && stack->top->indx != FRAME_SHARED && pcbOf(pcbs, stack->top->indx)->p_table[stack->top->pg].huge)
+		splitHuge(stack->top->indx, stack->top->pg);
+
+	NodeOfList *victim = NULL;
+	if (self == NULL)
+	{
+		/* With tiers, pages only leave memory from the slow tier */
+		if (policy == POLICY_AGING)
+			victim = agedVictim();
+		else if (policy == POLICY_CLOCK)
+			victim = clockVictim();
+		else if (slowNode != -1)
+			victim = coldestPage(true);
+		if (victim == NULL)
+			victim = stack->top;
+	}
+	else
+	{
+		/* Skip pages of processes another worker is in the middle of, rather than wait on them */
+		pthread_mutex_lock(&mmLock);
+		victim = stack->top;
+		while (victim == NULL || (victim->indx != sp_id && pthread_mutex_trylock(&pcbOf(pcbs, victim->indx)->lock) != 0))
+		{
+			if (victim != NULL)
+			{
+				victim = victim->nxt;
+				continue;
+			}
+			pthread_mutex_unlock(&mmLock);
+			sched_yield();
+			pthread_mutex_lock(&mmLock);
+			victim = stack->top;
+		}
+	}
+
+	int indx = victim->indx;
+	int pg = victim->pg;
+	unsigned int addr = pg << 10;
+	int frm = victim->frm;
+
+	/* Page replacement, unmapping the page from every process that maps it */
+	if (indx == FRAME_SHARED)
+	{
+		for (i = 0; i < pcbs->capacity; i++)
+		{
+			if (pcbOf(pcbs, i) == NULL)
+				continue;
+			PTE *pte = &pcbOf(pcbs, i)->p_table[pg];
+			if (bitTest(pcbOf(pcbs, i)->valid, pg) && pte->frm == frm)
+			{
+				pte->frm = PTE_NO_FRAME;
+				bitClear(pcbOf(pcbs, i)->valid, pg);
+				tlbInvalidate(tlb, i, pg);
+			}
+		}
+		frames_saved -= frames[frm].refs - 1;
+		sharedFrm[pg] = -1;
+	}
+	else
+	{
+		if ((zswapFrames == 0 || pg < sharedPages) && bitTest(pcbOf(pcbs, indx)->dirty, pg))
+		{
+			flog("Address %d-%d was fixed, writing back to disk\n", addr, pg);
+		}
+
+		pcbOf(pcbs, indx)->p_table[pg].frm = PTE_NO_FRAME;
+		bitClear(pcbOf(pcbs, indx)->dirty, pg);
+		bitClear(pcbOf(pcbs, indx)->valid, pg);
+		if (zswapFrames > 0 && pg >= sharedPages)
+			zswapStore(indx, pg);
+		lockIf(&workers[indx % threads].tlbLock);
+		tlbInvalidate(tlbOf(indx), indx, pg);
+		unlockIf(&workers[indx % threads].tlbLock);
+	}
+	removeFrmList(stack, indx, pg, frm);
+
+	if (self != NULL)
+	{
+		frames[frm].sp_id = -1;
+		if (indx != sp_id)
+			pthread_mutex_unlock(&pcbOf(pcbs, indx)->lock);
+		pthread_mutex_unlock(&mmLock);
+	}
+
+	return frm;
+}
+
+int freeFrameCount()
+{
+	return frameCount - bitmapCountRange(memory, 0, frameCount);
+}
+
+/* Takes the first free frame of a node from its cursor on, wrapping around; -1 if the node is full */
+int takeFrame(Node *node)
+{
+	int end = node->base + node->size;
+	int frm = bitmapNext(memory, node->base + node->cursor, end, false);
+
+	if (frm == -1)
+		frm = bitmapNext(memory, node->base, node->base + node->cursor, false);
+	if (frm == -1)
+		return -1;
+
+	node->cursor = (frm - node->base + 1) % node->size;
+	if (self == NULL)
+		bitSet(memory, frm);
+	else
+		bitSetAtomic(memory, frm);
+	return frm;
+}
+
+/* Working-set sampler in the style of DAMON: each pass checks the one watched page per region, then marks a new one idle,
+   so a pass costs a few bit tests per region however much memory there is */
+void wssScan()
+{
+	char buf[BUFFER_LENGTH];
+	int len = snprintf(buf, BUFFER_LENGTH, "Working sets:");
+	int total = 0;
+	int sp_id, r;
+
+	for (sp_id = 0; sp_id < pcbs->capacity; sp_id++)
+	{
+		PCB *pcb = pcbOf(pcbs, sp_id);
+		if (pcb == NULL)
+			continue;
+
+		int resident = bitmapCount(pcb->valid, PT_WORDS);
+		int hot = 0, cold = 0;
+		for (r = 0; r < wssRegions; r++)
+		{
+			int from = r * MAX_PAGES / wssRegions;
+			int size = (r + 1) * MAX_PAGES / wssRegions - from;
+			int pg = pcb->wssSample[r];
+
+			/* A region counts with all its resident pages, as accessed or idle by its watched page */
+			if (pg != -1 && bitTest(pcb->valid, pg))
+			{
+				if (bitTest(pcb->idle, pg))
+					cold += bitmapCountRange(pcb->valid, from, size);
+				else
+					hot += bitmapCountRange(pcb->valid, from, size);
+			}
+
+			pcb->wssSample[r] = pg = wssPick(pcb, sp_id, from, size);
+			if (pg != -1)
+				bitSet(pcb->idle, pg);
+		}
+		if (resident == 0)
+			continue;
+
+		pcb->wss = hot;
+		total += hot;
+		wss_sum += hot;
+		wss_samples++;
+		wss_hot += hot;
+		wss_cold += cold;
+		if (len < BUFFER_LENGTH)
+			len += snprintf(buf + len, BUFFER_LENGTH - len, " P%d:%d/%d", sp_id, hot, resident);
+	}
+
+	if (total > peak_wss)
+		peak_wss = total;
+	count_wss_pass++;
+	flog("%s\n", buf);
+}
+
+/* Picks a resident page of the region to watch, starting the search at a spot that moves from pass to pass */
+int wssPick(PCB *pcb, int sp_id, int from, int size)
+{
+	int start = (unsigned int) (count_wss_pass * 2654435761u + sp_id * 40503u + from) % size;
+	int i;
+
+	for (i = 0; i < size; i++)
+	{
+		int pg = from + (start + i) % size;
+		if (bitTest(pcb->valid, pg))
+			return pg;
+	}
+	return -1;
+}
+
+/* Medium-term scheduler: swaps a process out while faults are frequent and free frames scarce, and brings one back once faults calm down */
+void loadControl()
+{
+	int refs = count_mem_acc - load_refs;
+	int faults = count_pg_fault - load_faults;
+	unsigned long long ns = clockNs() - load_start;
+	int percent = (refs > 0) ? faults * 100 / refs : 0;
+	int pressure = (wmarkMin > 0) ? wmarkLow : frameCount / LOAD_FREE_SHARE;
+
+	/* Account the interval to thrashing or to holding back, to compare throughput between the two */
+	if (!isQueueEmpty(suspended))
+	{
+		held_ns += ns;
+		held_refs += refs;
+	}
+	else if (percent > loadHigh)
+	{
+		thrash_ns += ns;
+		thrash_refs += refs;
+	}
+
+	if (percent > loadHigh && freeFrameCount() < pressure && sizeOfQueue(que) > LOAD_MIN_RUNNING && !quit)
+		suspendProcess();
+	else if (!isQueueEmpty(suspended) && (percent < loadLow || quit || isQueueEmpty(que)))
+		resumeProcess();
+
+	load_start = clockNs();
+	load_refs = count_mem_acc;
+	load_faults = count_pg_fault;
+}
+
+/* Swaps out the running process with the most resident pages, releasing its frames */
+void suspendProcess()
+{
+	QueNode *node;
+	int victim = -1, most = -1;
+
+	for (node = que->frnt; node != NULL; node = node->nxt)
+	{
+		int resident = bitmapCount(pcbOf(pcbs, node->indx)->valid, PT_WORDS);
+		if (resident > most)
+		{
+			victim = node->indx;
+			most = resident;
+		}
+	}
+
+	removeFromQueue(que, victim);
+	releasePages(victim);
+	enqueue(suspended, victim);
+	count_suspend++;
+	flog("P%d suspended by load control, swapping out %d pages\n", victim, most);
+}
+
+/* Puts the longest suspended process back on the run queue, to fault its pages back in */
+void resumeProcess()
+{
+	int sp_id = suspended->frnt->indx;
+
+	dequeue(suspended);
+	enqueue(que, sp_id);
+	count_resume++;
+	flog("P%d resumed by load control\n", sp_id);
+}
+
+/* Background reclaim in the style of kswapd: woken below the low watermark, it evicts a batch per pass until the high one is reached */
+void kswapd()
+{
+	int free = freeFrameCount();
+	int i;
+
+	if (!kswapdAwake && free >= wmarkLow)
+		return;
+	if (!kswapdAwake)
+	{
+		kswapdAwake = true;
+		count_kswapd_wake++;
+		flog("kswapd woken with %d free frames\n", free);
+	}
+
+	profEnter(PHASE_REPLACE);
+	for (i = 0; i < KSWAPD_BATCH && free < wmarkHigh && stack->top != NULL; i++, free++)
+	{
+		freeFrame(evictPage(-1));
+		count_kswapd_reclaim++;
+	}
+	profLeave();
+
+	if (free >= wmarkHigh || stack->top == NULL)
+	{
+		kswapdAwake = false;
+		flog("kswapd sleeping with %d free frames\n", free);
+	}
+}
+
+/* Maps an allocated (or, when shared, possibly already resident) frame into a process' page table */
+void mapFrame(int sp_id, int pg, int frm, bool shared)
+{
+	PTE *pte = &pcbOf(pcbs, sp_id)->p_table[pg];
+	pte->frm = frm;
+	bitSet(pcbOf(pcbs, sp_id)->valid, pg);
+
+	if (shared && sharedFrm[pg] == frm)
+	{
+		/* Another user of a resident shared frame */
+		frames[frm].refs++;
+		frames_saved++;
+		if (frames_saved > peak_frames_saved)
+			peak_frames_saved = frames_saved;
+		touchPage(sp_id, pg);
+		return;
+	}
+
+	profEnter(PHASE_REPLACE);
+	lockIf(&mmLock);
+	frames[frm].sp_id = shared ? FRAME_SHARED : sp_id;
+	frames[frm].pg = pg;
+	frames[frm].refs = 1;
+	frames[frm].heat = 0;
+	ages[frm] = AGE_NEW;
+	if (shared)
+		sharedFrm[pg] = frm;
+	append(stack, frames[frm].sp_id, pg, frm);
+	unlockIf(&mmLock);
+	profLeave();
+}
+
+/* Drops every page a terminated process maps, freeing frames nobody else uses */
+void releasePages(int sp_id)
+{
+	int i;
+
+	profEnter(PHASE_REPLACE);
+	lockIf(&workers[sp_id % threads].tlbLock);
+	tlbFlushProcess(tlbOf(sp_id), sp_id);
+	unlockIf(&workers[sp_id % threads].tlbLock);
+
+	lockIf(&mmLock);
+	for (i = 0; i < MAX_PAGES; i++)
+	{
+		PTE *pte = &pcbOf(pcbs, sp_id)->p_table[i];
+		if (pte->zswap)
+			zswapDrop(sp_id, i);
+		if (!bitTest(pcbOf(pcbs, sp_id)->valid, i))
+			continue;
+
+		int frm = pte->frm;
+		pte->frm = PTE_NO_FRAME;
+
+		if (pte->huge)
+		{
+			/* A huge page has a single stack entry, kept under its first page */
+			pte->huge = 0;
+			if (i % HUGE_PAGE_PAGES == 0)
+				removeFrmList(stack, sp_id, i, frm);
+			freeFrame(frm);
+			continue;
+		}
+
+		if (frames[frm].sp_id == FRAME_SHARED && --frames[frm].refs > 0)
+		{
+			frames_saved--;
+			continue;
+		}
+		if (frames[frm].sp_id == FRAME_SHARED)
+			sharedFrm[i] = -1;
+
+		removeFrmList(stack, frames[frm].sp_id, i, frm);
+		freeFrame(frm);
+	}
+	memset(pcbOf(pcbs, sp_id)->valid, 0, sizeof(pcbOf(pcbs, sp_id)->valid));
+	memset(pcbOf(pcbs, sp_id)->dirty, 0, sizeof(pcbOf(pcbs, sp_id)->dirty));
+	memset(pcbOf(pcbs, sp_id)->referenced, 0, sizeof(pcbOf(pcbs, sp_id)->referenced));
+	unlockIf(&mmLock);
+	profLeave();
+}
+
+void freeFrame(int frm)
+{
+	frames[frm].sp_id = -1;
+	frames[frm].refs = 0;
+
+	if (self == NULL)
+	{
+		bitClear(memory, frm);
+		return;
+	}
+
+	/* A bitmap word can span two shards, so the bit is cleared atomically under the lock of the frame's own shard */
+	int s = frm / shards[0].size;
+	if (s >= threads)
+		s = threads - 1;
+	pthread_mutex_lock(&shardLock[s]);
+	bitClearAtomic(memory, frm);
+	pthread_mutex_unlock(&shardLock[s]);
+}
+
+/* Returns the least recently used private base page of the slow or the fast tier, NULL if there is none */
+NodeOfList *coldestPage(bool slow)
+{
+	NodeOfList *node;
+	for (node = stack->top; node != NULL; node = node->nxt)
+		if (node->indx != FRAME_SHARED && !pcbOf(pcbs, node->indx)->p_table[node->pg].huge && (nodeOf(node->frm) == slowNode) == slow)
+			return node;
+	return NULL;
+}
+
+/* Returns the stack entry of a frame the policy picked, splitting a huge page so that only that base page goes */
+NodeOfList *stackEntryOf(int frm)
+{
+	int owner = frames[frm].sp_id;
+	int pg = frames[frm].pg;
+
+	if (owner >= 0 && pcbOf(pcbs, owner)->p_table[pg].huge)
+		splitHuge(owner, pg - pg % HUGE_PAGE_PAGES);
+	NodeOfList *node = findInList(stack, owner, pg, frm);
+	if (node == NULL)
+		flog("Frame %d picked for replacement is not in the stack, evicting the oldest page instead\n", frm);
+	return node;
+}
+
+/* Picks the frame with the oldest aging counter, from the slow tier when there is one, and returns its stack entry */
+NodeOfList *agedVictim()
+{
+	int base = 0, count = frameCount;
+
+	if (slowNode != -1)
+	{
+		base = nodes[slowNode].base;
+		count = nodes[slowNode].size;
+	}
+
+	/* Free frames keep stale counters that age toward 0, so only frames in use are candidates */
+	int frm = ageMin(ages, memory, base, base + count);
+	if (frm == -1)
+		return NULL;
+	return stackEntryOf(frm);
+}
+
+/* Second chance: the hand clears referenced bits until it meets a frame without one, or has gone round twice */
+NodeOfList *clockVictim()
+{
+	int base = 0, count = frameCount;
+	int i;
+
+	if (slowNode != -1)
+	{
+		base = nodes[slowNode].base;
+		count = nodes[slowNode].size;
+	}
+
+	for (i = 0; i < 2 * count; i++)
+	{
+		/* Free frames have nothing to clear, so the hand jumps over them a bitmap word at a time */
+		int frm = bitmapNext(memory, base + clockHand % count, base + count, true);
+		if (frm == -1)
+		{
+			i += base + count - (base + clockHand % count) - 1;
+			clockHand = 0;
+			continue;
+		}
+		i += frm - (base + clockHand % count);
+		clockHand = (frm - base + 1) % count;
+		if (i >= 2 * count)
+			break;
+		if (bitTest(clockRef, frm))
+		{
+			bitClear(clockRef, frm);
+			continue;
+		}
+
+		return stackEntryOf(frm);
+	}
+	return NULL;
+}
+
+/* Feeds a sampled share of the references to the shadow policies; after every window the live policy follows the one missing least */
+void duel(int sp_id, unsigned int pg)
+{
+	uint32_t key = (uint32_t) sp_id * MAX_PAGES + pg;
+	int i, best = policy;
+
+	policyRefs[policy]++;
+	if (((key * 2654435761u) >> 16) % DUEL_SAMPLE != 0)
+		return;
+
+	for (i = 0; i < POLICY_ADAPTIVE; i++)
+		shadowAccess(shadows[i], key, clockNs());
+	if (++duelRefs < DUEL_WINDOW)
+		return;
+
+	duelRefs = 0;
+	for (i = 0; i < POLICY_ADAPTIVE; i++)
+		shadowWindow(shadows[i], DUEL_WINDOW);
+	for (i = 0; i < POLICY_ADAPTIVE; i++)
+		if (shadows[i]->missRate < shadows[best]->missRate)
+			best = i;
+
+	if (best != policy && shadows[best]->missRate + DUEL_MARGIN < shadows[policy]->missRate)
+	{
+		flog("Replacement policy switched from %s to %s, shadow miss ratios %f and %f\n", policyNames[policy], policyNames[best], shadows[policy]->missRate, shadows[best]->missRate);
+		policy = best;
+		count_policy_switch++;
+	}
+}
+
+/* Migrates the page of a stack entry to frame dst, keeping its place in the stack; the old frame is left to the caller */
+void movePage(NodeOfList *page, int dst, int heat)
+{
+	frames[dst].sp_id = page->indx;
+	frames[dst].pg = page->pg;
+	frames[dst].refs = 1;
+	frames[dst].heat = heat;
+	ages[dst] = ages[page->frm];
+	if (bitTest(clockRef, page->frm))
+		bitSet(clockRef, dst);
+	else
+		bitClear(clockRef, dst);
+	bitSet(memory, dst);
+
+	/* The caches are physically addressed, so neither frame's lines hold the page any more */
+	cacheInvalidateFrame(page->frm);
+	cacheInvalidateFrame(dst);
+
+	pcbOf(pcbs, page->indx)->p_table[page->pg].frm = dst;
+	page->frm = dst;
+	tlbInvalidate(tlb, page->indx, page->pg);
+}
+
+/* Background pass that samples referenced bits into frame heat, then promotes hot slow tier pages */
+void tierScan()
+{
+	NodeOfList *hot;
+	int i, moved = 0;
+
+	for (i = 0; i < frameCount; i++)
+	{
+		frames[i].heat /= 2;
+		if (frames[i].sp_id < 0)
+			continue;
+		uint32_t *referenced = pcbOf(pcbs, frames[i].sp_id)->referenced;
+		if (bitTest(referenced, frames[i].pg))
+		{
+			frames[i].heat += TIER_REF_HEAT;
+			bitClear(referenced, frames[i].pg);
+		}
+	}
+
+	for (hot = stack->top; hot != NULL && moved < TIER_MIGRATE_MAX; hot = hot->nxt)
+	{
+		int src = hot->frm;
+		if (nodeOf(src) != slowNode || hot->indx == FRAME_SHARED || frames[src].heat < TIER_HOT_HEAT)
+			continue;
+
+		/* A huge page has to stay in its contiguous run, so it is not migrated frame by frame */
+		if (pcbOf(pcbs, hot->indx)->p_table[hot->pg].huge)
+			continue;
+
+		/* Use a free fast frame, or trade places with the coldest fast page */
+		int dst;
+		for (dst = 0; dst < nodes[slowNode].base; dst++)
+			if (!bitTest(memory, dst))
+				break;
+		if (dst < nodes[slowNode].base)
+		{
+			movePage(hot, dst, frames[src].heat);
+			freeFrame(src);
+		}
+		else
+		{
+			NodeOfList *cold = coldestPage(false);
+			if (cold == NULL || frames[cold->frm].heat >= frames[src].heat)
+				continue;
+			dst = cold->frm;
+			int coldHeat = frames[dst].heat;
+			uint8_t coldAge = ages[dst];
+			movePage(hot, dst, frames[src].heat);
+			movePage(cold, src, coldHeat);
+			ages[src] = coldAge;
+			count_demote++;
+		}
+		count_promote++;
+		moved++;
+
+		flog("Promoted address %d-%d of Process:%d from frame %d to frame %d\n", hot->pg << 10, hot->pg, hot->indx, src, dst);
+	}
+}
+
+/* Compresses an evicted page into the tier, writing the oldest one back to disk when it is full */
+void zswapStore(int sp_id, int pg)
+{
+	if (zswapStored == zswapCapacity)
+	{
+		NodeOfList *old = zswap->top;
+		flog("Address %d-%d of Process:%d moved from the compressed tier to disk\n", old->pg << 10, old->pg, old->indx);
+		pcbOf(pcbs, old->indx)->p_table[old->pg].zswap = 0;
+		pop(zswap);
+		zswapStored--;
+		count_zswap_writeback++;
+	}
+
+	append(zswap, sp_id, pg, -1);
+	pcbOf(pcbs, sp_id)->p_table[pg].zswap = 1;
+	zswapStored++;
+	if (zswapStored > peak_zswap_stored)
+		peak_zswap_stored = zswapStored;
+	count_zswap_store++;
+	statAdd(tot_acc_time, clckAvance(zswapCompress * 1000 + 1));
+
+	flog("Address %d-%d of Process:%d compressed into the tier\n", pg << 10, pg, sp_id);
+}
+
+/* Takes a faulting page back out of the tier */
+void zswapLoad(int sp_id, int pg)
+{
+	zswapDrop(sp_id, pg);
+	count_zswap_hit++;
+
+	flog("Address %d-%d of Process:%d decompressed from the tier\n", pg << 10, pg, sp_id);
+}
+
+void zswapDrop(int sp_id, int pg)
+{
+	removeFrmList(zswap, sp_id, pg, -1);
+	pcbOf(pcbs, sp_id)->p_table[pg].zswap = 0;
+	zswapStored--;
+}
+
+/* Moves the stack entry covering a mapped page to the most recently used end */
+void touchPage(int sp_id, int pg)
+{
+	PTE *pte = &pcbOf(pcbs, sp_id)->p_table[pg];
+	int frm = pte->frm;
+	int owner = frames[frm].sp_id;
+
+	/* Workers batch the move and apply it later with others */
+	if (self != NULL)
+	{
+		self->pvSpid[self->pvCount] = sp_id;
+		self->pvPg[self->pvCount] = pg;
+		self->pvFrm[self->pvCount] = frm;
+		if (++self->pvCount == PAGEVEC_SIZE)
+			drainPagevec(self);
+		return;
+	}
+
+	/* Aging and clock only need referenced bits, so a hit leaves the stack alone, unless LRU may take over later */
+	if (policy != POLICY_LRU && !dueling)
+		return;
+
+	profEnter(PHASE_REPLACE);
+	if (pte->huge)
+	{
+		pg -= pg % HUGE_PAGE_PAGES;
+		frm = pcbOf(pcbs, sp_id)->p_table[pg].frm;
+	}
+
+	removeFrmList(stack, owner, pg, frm);
+	append(stack, owner, pg, frm);
+	profLeave();
+}
+
+/* Returns the first frame of a free aligned run that can hold a huge page, otherwise -1 */
+int findHugeRun(int sp_id, int pg)
+{
+	int order[MAX_NODES];
+	int n = nodeOrder(sp_id, pg, order);
+	int k, head;
+
+	for (k = 0; k < n; k++)
+	{
+		Node *node = &nodes[order[k]];
+		head = (node->base + HUGE_PAGE_PAGES - 1) / HUGE_PAGE_PAGES * HUGE_PAGE_PAGES;
+		for (; head + HUGE_PAGE_PAGES <= node->base + node->size; head += HUGE_PAGE_PAGES)
+			if (isRunFree(head))
+				return head;
+	}
+	return -1;
+}
+
+bool isRunFree(int head)
+{
+	return bitmapCountRange(memory, head, HUGE_PAGE_PAGES) == 0;
+}
+
+/* Fills order with the nodes a page may be allocated from, best first; returns how many */
+int nodeOrder(int sp_id, int pg, int *order)
+{
+	int first;
+	int i, j, n = 0;
+
+	if (numaPolicy == NUMA_INTERLEAVE)
+		first = pg % nodeCount;
+	else if (numaPolicy == NUMA_PREFERRED)
+		first = preferredNode;
+	else
+		first = pcbOf(pcbs, sp_id)->node;
+
+	/* Fall back to the other nodes, nearest first */
+	order[n++] = first;
+	for (i = 0; i < nodeCount; i++)
+		if (i != first)
+		{
+			for (j = n; j > 1 && distance[first][order[j - 1]] > distance[first][i]; j--)
+				order[j] = order[j - 1];
+			order[j] = i;
+			n++;
 		}
-	}
+	return n;
 }
-void spawnTheProcess(int sp_id)
+
+int nodeOf(int frm)
 {
-	/* Fork a new user process */
-	pid_t p_id = fork();
+	int i;
+	for (i = nodeCount - 1; i > 0; i--)
+		if (frm >= nodes[i].base)
+			return i;
+	return 0;
+}
 
-	/* Record its PID */
-	pids[sp_id] = p_id;
+/* Parses a comma separated list of integers; returns how many, or -1 if malformed */
+int parseInts(char *arg, int *out, int max)
+{
+	int n = 0;
+	char *end;
 
-	if (p_id == -1)
-		crash("fork");
-	else if (p_id == 0)
+	while (true)
 	{
-		/* Since child, execute a new user process */
-		char arg0[BUFFER_LENGTH];
-		char arg1[BUFFER_LENGTH];
-		sprintf(arg0, "%d", sp_id);
-		sprintf(arg1, "%d", schm);
-		execl("./user", "user", arg0, arg1, (char *)NULL);
-		crash("execl");
+		if (n == max || !isdigit(*arg))
+			return -1;
+		out[n++] = strtol(arg, &end, 10);
+		if (*end == '\0')
+			return n;
+		if (*end != ',')
+			return -1;
+		arg = end + 1;
 	}
-
-	/* Since parent, initialize the new user process for simulation */
-	init_PCB(p_id, sp_id);
-	enqueue(que, sp_id);
-	act_count++;
-	spawn_count++;
-
-	flog("p%d created\n", sp_id);
 }
-void flog(char *fmt, ...)
-{
-	FILE *fp = fopen(PATH_LOG, "a+");
-	if (fp == NULL)
-		crash("fopen");
-
-	char buf[BUFFER_LENGTH];
-	va_list args;
-	va_start(args, fmt);
-	vsnprintf(buf, BUFFER_LENGTH, fmt, args);
-	va_end(args);
 
-	char buff[BUFFER_LENGTH];
-	snprintf(buff, BUFFER_LENGTH, "%s[%d.%d] %s", basename(prgName), sys->clock.s, sys->clock.ns, buf);
-
-	fprintf(stderr, buff);
-	fprintf(fp, buff);
+/* Parses cache levels given as size:ways[:line], comma separated and L1 first; returns how many, or -1 if malformed */
+int parseCaches(char *arg)
+{
+	int n = 0;
+	char *end;
 
-	fclose(fp);
+	while (true)
+	{
+		int size, ways, line = CACHE_LINE;
+
+		if (n == MAX_CACHES || !isdigit(*arg))
+			return -1;
+		size = strtol(arg, &end, 10);
+		if (*end != ':')
+			return -1;
+		ways = strtol(end + 1, &end, 10);
+		if (*end == ':')
+			line = strtol(end + 1, &end, 10);
+		if (ways <= 0 || line <= 0 || size <= 0 || size % (ways * line) != 0)
+			return -1;
+		caches[n++] = newCache(size, ways, line);
+		if (*end == '\0')
+			return n;
+		if (*end != ',')
+			return -1;
+		arg = end + 1;
+	}
 }
-/* Sends and receives messages from user processes, and acts upon them */
-void processesHandler()
+
+/* Runs a byte reference through the cache levels at its physical address, charging each level it reaches */
+void cacheReference(int home, int frm, unsigned int addr, int node)
 {
-	QueNode *nxt = que->frnt;
-	Que *temp = newQueue();
+	unsigned long paddr = ((unsigned long) frm << PAGE_SHIFT) + addr % (1 << PAGE_SHIFT);
+	unsigned long long ns = 0;
+	int i;
 
-	/* While we have user processes to simulate */
-	while (nxt != NULL)
+	lockIf(&cacheLock);
+	for (i = 0; i < cacheCount; i++)
 	{
-		clckAvance(0);
+		ns += cacheNs[i];
+		if (cacheAccess(caches[i], paddr))
+			break;
+	}
+	if (i == cacheCount)
+		ns += CACHE_MEM_NS * distance[home][node] / NUMA_LOCAL_DISTANCE;
+	count_cache_acc++;
+	cache_ns += ns;
+	unlockIf(&cacheLock);
+}
 
-		/* Send a msg to a user process saying it's your turn to "run" */
-		int sp_id = nxt->indx;
-		msg.type = sys->p_table[sp_id].p_id;
-		msg.sp_id = sp_id;
-		msg.p_id = sys->p_table[sp_id].p_id;
-		msgsnd(msq_id, &msg, sizeof(Message), 0);
+/* A frame filled from disk no longer matches what the caches hold for it */
+void cacheInvalidateFrame(int frm)
+{
+	int i;
 
-		/* Receive a response of what they're doing */
-		msgrcv(msq_id, &msg, sizeof(Message), 1, 0);
+	lockIf(&cacheLock);
+	for (i = 0; i < cacheCount; i++)
+		cacheInvalidate(caches[i], (unsigned long) frm << PAGE_SHIFT, 1 << PAGE_SHIFT);
+	unlockIf(&cacheLock);
+}
 
-		clckAvance(0);
+/* A region can be faulted in as a huge page if it is private and none of it is resident yet */
+bool isHugeCandidate(int sp_id, int pg)
+{
+	int head = pg - pg % HUGE_PAGE_PAGES;
+	int i;
 
-		if (msg.terminate)
-		{
-			showMemoryMap();
+	if (head < sharedPages || bitmapCountRange(pcbOf(pcbs, sp_id)->valid, head, HUGE_PAGE_PAGES) > 0)
+		return false;
+	for (i = head; i < head + HUGE_PAGE_PAGES; i++)
+		if (pcbOf(pcbs, sp_id)->p_table[i].zswap)
+			return false;
+	return true;
+}
 
-			flog("P%d has terminated, freeing memory\n", sp_id);
+/* Maps a whole aligned region onto the frame run starting at head, as one stack entry */
+void mapHuge(int sp_id, int headPg, int head)
+{
+	int i;
+	for (i = 0; i < HUGE_PAGE_PAGES; i++)
+	{
+		PTE *pte = &pcbOf(pcbs, sp_id)->p_table[headPg + i];
+		int frm = head + i;
+
+		pte->frm = frm;
+		pte->huge = 1;
+		bitSet(pcbOf(pcbs, sp_id)->valid, headPg + i);
+		bitClear(pcbOf(pcbs, sp_id)->dirty, headPg + i);
+		frames[frm].sp_id = sp_id;
+		frames[frm].pg = headPg + i;
+		frames[frm].refs = 1;
+		frames[frm].heat = 0;
+		ages[frm] = AGE_NEW;
+		bitSet(memory, frm);
+	}
+	append(stack, sp_id, headPg, head);
+}
 
-			/* Free process' frames */
-			int i;
-			for (i = 0; i < MAX_PAGES; i++)
-			{
-				if (sys->p_table[sp_id].p_table[i].frm != -1)
-				{
-					int frm = sys->p_table[sp_id].p_table[i].frm;
-					removeFrmList(rfrnce, sp_id, i, frm);
-					memory[frm / 8] &= ~(1 << (frm % 8));
-				}
-			}
-		}
-		else
-		{
-			int currFrm;
-			tot_acc_time += clckAvance(1000000);
-			enqueue(temp, sp_id);
+/* Breaks a huge page back into base pages, placed oldest in the stack so they are evicted first */
+void splitHuge(int sp_id, int headPg)
+{
+	PTE *pt = &pcbOf(pcbs, sp_id)->p_table[headPg];
+	int head = pt[0].frm;
+	int i;
 
-			// Frame allocation procedure
+	removeFrmList(stack, sp_id, headPg, head);
+	for (i = HUGE_PAGE_PAGES - 1; i >= 0; i--)
+	{
+		pt[i].huge = 0;
+		push(stack, sp_id, headPg + i, pt[i].frm);
+	}
+	tlbInvalidate(tlb, sp_id, headPg);
+	count_split++;
 
-			unsigned int reqAddr = msg.addr;
-			unsigned int reqPg = msg.pg;
+	flog("Split huge page at frames %d-%d of Process:%d\n", head, head + HUGE_PAGE_PAGES - 1, sp_id);
+}
 
-			if (sys->p_table[sp_id].p_table[reqPg].protec == 0)
-			{
-				flog("Process:%d request reading from the address %d-%d\n", sp_id, reqAddr, reqPg);
-			}
-			else
-			{
-				flog("Process:%d request writing to the address %d-%d\n", sp_id, reqAddr, reqPg);
-			}
+/* Background pass in the style of khugepaged, looking at a bounded number of regions each time */
+void collapseScan()
+{
+	int regions = MAX_PAGES / HUGE_PAGE_PAGES;
+	int i, free = 0, runs = 0;
+
+	/* Sample fragmentation: the share of free frames that cannot back a huge page */
+	free = freeFrameCount();
+	for (i = 0; i + HUGE_PAGE_PAGES <= frameCount; i += HUGE_PAGE_PAGES)
+		if (nodeOf(i) == nodeOf(i + HUGE_PAGE_PAGES - 1) && isRunFree(i))
+			runs++;
+	if (free > 0)
+	{
+		frag_sum += 1.0 - (double) (runs * HUGE_PAGE_PAGES) / (double) free;
+		frag_samples++;
+	}
 
-			count_mem_acc++;
+	for (i = 0; i < HUGE_SCAN_REGIONS; i++)
+	{
+		int sp_id = scanCursor / regions;
+		int headPg = (scanCursor % regions) * HUGE_PAGE_PAGES;
+		scanCursor = (scanCursor + 1) % (pcbs->capacity * regions);
 
-			if (sys->p_table[sp_id].p_table[reqPg].valid == 0)
-			{
-				flog("Address %d-%d not in the frame, PAGEFAULT Error\n", reqAddr, reqPg);
-
-				count_pg_fault++;
-
-				tot_acc_time += clckAvance(10 * 1000000);
-
-				/* Find available frame */
-				bool isMemoryOpen = false;
-				int frmCount = 0;
-				while (true)
-				{
-					currFrm = (currFrm + 1) % MAX_FRAMES;
-					if ((memory[currFrm / 8] & (1 << (currFrm % 8))) == 0)
-					{
-						isMemoryOpen = true;
-						break;
-					}
-					if (frmCount >= MAX_FRAMES - 1)
-						break;
-					frmCount++;
-				}
-
-				/* Check if there is still space in memory */
-				if (isMemoryOpen)
-				{
-					sys->p_table[sp_id].p_table[reqPg].frm = currFrm;
-					sys->p_table[sp_id].p_table[reqPg].valid = 1;
-
-					memory[currFrm / 8] |= (1 << (currFrm % 8));
-
-					append(rfrnce, sp_id, reqPg, currFrm);
-					flog("Allocated frame %d to Process:%d\n", currFrm, sp_id);
-
-					removeFrmList(stack, sp_id, reqPg, currFrm);
-					append(stack, sp_id, reqPg, currFrm);
-
-					if (sys->p_table[sp_id].p_table[reqPg].protec == 0)
-					{
-						flog("Address %d-%d in frame %d, giving data to Process:%d\n", reqAddr, reqPg, sys->p_table[sp_id].p_table[reqPg].frm, sp_id);
-						sys->p_table[sp_id].p_table[reqPg].dirty = 0;
-					}
-					else
-					{
-						flog("Address %d-%d in frame %d, writing data to Process:%d\n", reqAddr, reqPg, sys->p_table[sp_id].p_table[reqPg].frm, sp_id);
-						sys->p_table[sp_id].p_table[reqPg].dirty = 1;
-					}
-				}
-				else
-				{
-					/* Handle when memory is full */
-
-					flog("Address %d-%d not in frame, memory is full\n", reqAddr, reqPg);
-
-					unsigned int indx = stack->top->indx;
-					unsigned int pg = stack->top->pg;
-					unsigned int addr = pg << 10;
-					unsigned int frm = stack->top->frm;
-
-					if (sys->p_table[indx].p_table[pg].dirty == 1)
-					{
-						flog("Address %d-%d was fixed, writing back to disk\n", addr, pg);
-					}
-
-					/* Page replacement */
-					sys->p_table[indx].p_table[pg].frm = -1;
-					sys->p_table[indx].p_table[pg].dirty = 0;
-					sys->p_table[indx].p_table[pg].valid = 0;
-					sys->p_table[sp_id].p_table[reqPg].frm = frm;
-					sys->p_table[sp_id].p_table[reqPg].dirty = 0;
-					sys->p_table[sp_id].p_table[reqPg].valid = 1;
-					removeFrmList(stack, indx, pg, frm);
-					removeFrmList(rfrnce, indx, pg, frm);
-					append(stack, sp_id, reqPg, frm);
-					append(rfrnce, sp_id, reqPg, frm);
-
-					if (sys->p_table[sp_id].p_table[reqPg].protec == 1)
-					{
-						sys->p_table[sp_id].p_table[reqPg].dirty = 1;
-						flog("Dirty bit of frame %d , adding more time to the clock\n", currFrm);
-					}
-				}
-			}
-			 else
-			{
-				// Update LRU stack
-				int frm = sys->p_table[sp_id].p_table[reqPg].frm;
-				removeFrmList(stack, sp_id, reqPg, frm);
-				append(stack, sp_id, reqPg, frm);
-
-				if (sys->p_table[sp_id].p_table[reqPg].protec == 0)
-				{
-					flog("Address %d-%d already in frame %d, giving data to Process:%d\n", reqAddr, reqPg, sys->p_table[sp_id].p_table[reqPg].frm, sp_id);
-				}
-				else
-				{
-					flog("Address %d-%d already in frame %d, writing data to Process:%d\n", reqAddr, reqPg, sys->p_table[sp_id].p_table[reqPg].frm, sp_id);
-				}
-			} 
-		}
+		if (sp_id < pcbs->capacity && pcbOf(pcbs, sp_id) != NULL)
+			collapseRegion(sp_id, headPg);
+	}
+}
 
-		showMemoryMap();
+/* Copies the resident pages of a mostly populated region into a fresh huge page */
+void collapseRegion(int sp_id, int headPg)
+{
+	PTE *pt = &pcbOf(pcbs, sp_id)->p_table[headPg];
+	uint32_t *valid = pcbOf(pcbs, sp_id)->valid;
+	bool dirty[HUGE_PAGE_PAGES];
+	int resident = bitmapCountRange(valid, headPg, HUGE_PAGE_PAGES);
+	int i;
 
-		/* Reset msg */
-		msg.type = -1;
-		msg.sp_id = -1;
-		msg.p_id = -1;
-		msg.terminate = false;
-		msg.pg = -1;
+	if (headPg < sharedPages || (bitTest(valid, headPg) && pt[0].huge))
+		return;
+	for (i = 0; i < HUGE_PAGE_PAGES; i++)
+		if (pt[i].zswap)
+			return;
+	if (resident == 0 || HUGE_PAGE_PAGES - resident > HUGE_MAX_PTES_NONE)
+		return;
 
-		/* On to the nxt user process to simulate */
-		nxt = (nxt->nxt != NULL) ? nxt->nxt : NULL;
+	int head = findHugeRun(sp_id, headPg);
+	if (head == -1)
+	{
+		count_collapse_fail++;
+		return;
 	}
 
-	/* Reset the current queue */
-	while (!isQueueEmpty(que))
-		dequeue(que);
-	while (!isQueueEmpty(temp))
+	for (i = 0; i < HUGE_PAGE_PAGES; i++)
 	{
-		int i = temp->frnt->indx;
-		enqueue(que, i);
-		dequeue(temp);
+		dirty[i] = bitTest(valid, headPg + i) && bitTest(pcbOf(pcbs, sp_id)->dirty, headPg + i);
+		if (!bitTest(valid, headPg + i))
+			continue;
+		removeFrmList(stack, sp_id, headPg + i, pt[i].frm);
+		freeFrame(pt[i].frm);
+		tlbInvalidate(tlb, sp_id, headPg + i);
 	}
 
-	free(temp);
+	mapHuge(sp_id, headPg, head);
+	for (i = 0; i < HUGE_PAGE_PAGES; i++)
+		if (dirty[i])
+			bitSet(pcbOf(pcbs, sp_id)->dirty, headPg + i);
+	count_collapse++;
+
+	flog("Collapsed pages %d-%d of Process:%d into huge page at frames %d-%d\n", headPg, headPg + HUGE_PAGE_PAGES - 1, sp_id, head, head + HUGE_PAGE_PAGES - 1);
 }
 
 /* Attempts to spawn a new user process, but depends on the simulation's current state */
 void tryToSpawnTheProcess()
 {
 	/* Guard statements checking if we can even attempt to spawn a user process */
-	if (act_count >= PROCESSES_MAX)
+	if (act_count >= procMax)
+		return;
+	if (spawn_count >= procTotal)
 		return;
-	if (spawn_count >= PROCESSES_TOTAL)
+	if (!isQueueEmpty(suspended))
 		return;
-	if (nxt_spawn.ns < (rand() % (500 + 1)) * (1000000 + 1))
+	if (nxt_spawn.ns < (rand_r(&seed) % (500 + 1)) * (1000000 + 1))
 		return;
 	if (quit)
 		return;
@@ -456,16 +2537,28 @@ void tryToSpawnTheProcess()
 	/* Reset nxt spawn time */
 	nxt_spawn.ns = 0;
 
-	/* Try to find an available simulated PID */
+	/* Take an available simulated PID, the table grows if every slot is in use */
 	int sp_id = find_avail_PID();
 
-	/* Guard statement checking if we did find a PID */
-	if (sp_id == -1)
-		return;
-
 	/* Now we can spawn a simulated user process */
 	spawnTheProcess(sp_id);
 }
+/* Writes raw bytes to the log, used as the flush target of the debug dump buffer */
+void logWrite(const char *buf, size_t len)
+{
+	profEnter(PHASE_LOG);
+	FILE *fp = fopen(PATH_LOG, "a+");
+	if (fp == NULL)
+		crash("fopen");
+
+	fwrite(buf, 1, len, stderr);
+	fwrite(buf, 1, len, fp);
+
+	if (fclose(fp) == EOF)
+		crash("fclose");
+	profLeave();
+}
+
 void log(char *fmt, ...)
 {
 	FILE *fp = fopen(PATH_LOG, "a+");
@@ -486,48 +2579,54 @@ void log(char *fmt, ...)
 }
 void sysInit()
 {
-	int i, j;
+	int i;
 
 	/* Set default values in sys data structures */
-	for (i = 0; i < PROCESSES_MAX; i++)
+	for (i = 0; i < MAX_FRAMES; i++)
 	{
-		sys->p_table[i].p_id = -1;
-		sys->p_table[i].sp_id = -1;
-		for (j = 0; j < MAX_PAGES; j++)
-		{
-			sys->p_table[i].p_table[j].frm = -1;
-			sys->p_table[i].p_table[j].protec = rand() % 2;
-			sys->p_table[i].p_table[j].dirty = 0;
-			sys->p_table[i].p_table[j].valid = 0;
-		}
+		frames[i].sp_id = -1;
+		frames[i].pg = -1;
+		frames[i].refs = 0;
 	}
+	for (i = 0; i < MAX_PAGES; i++)
+		sharedFrm[i] = -1;
+	memcpy(dumped, frames, sizeof(frames));
+
+	/* PCBs come and go with their processes, so the table starts empty */
+	pcbs = newPcbTable(procMax);
+	traceIds = (int*) malloc(procMax * sizeof(int));
+	for (i = 0; i < procMax; i++)
+		traceIds[i] = -1;
 }
 
-void init_PCB(pid_t p_id, int sp_id)
+void init_PCB(pid_t p_id, int sp_id, unsigned int userSeed)
 {
 	int i;
 
 	/* Set default values in a user process' data structure */
-	PCB *pcb = &sys->p_table[sp_id];
-	pcb->p_id = p_id;
-	pcb->sp_id = sp_id;
+	PCB *pcb = pcbOf(pcbs, sp_id);
+	pcbSetPid(pcbs, sp_id, p_id);
+	pcb->seed = userSeed;
+	pcb->refs = 0;
+	pcb->node = spawn_count % ((slowNode == -1) ? nodeCount : slowNode);	/* The slow tier has no CPUs */
 	for (i = 0; i < MAX_PAGES; i++)
 	{
-		pcb->p_table[i].frm = -1;
-		pcb->p_table[i].protec = rand() % 2;
-		pcb->p_table[i].dirty = 0;
-		pcb->p_table[i].valid = 0;
+		pcb->p_table[i].frm = PTE_NO_FRAME;
+		pcb->p_table[i].protec = rand_r(&seed) % 2;
 	}
+	memset(pcb->valid, 0, sizeof(pcb->valid));
+	memset(pcb->dirty, 0, sizeof(pcb->dirty));
+	memset(pcb->referenced, 0, sizeof(pcb->referenced));
+	memset(pcb->idle, 0, sizeof(pcb->idle));
+	for (i = 0; i < MAX_PAGES; i++)
+		pcb->wssSample[i] = -1;
+	pcb->wss = 0;
 }
 
-/* Returns values [0-PROCESSES_MAX] for a found available PID, otherwise -1 for not found */
+/* Takes a free simulated PID off the process table's stack and gives it a PCB */
 int find_avail_PID()
 {
-	int i;
-	for (i = 0; i < PROCESSES_MAX; i++)
-		if (pids[i] == 0)
-			return i;
-	return -1;
+	return pcbAlloc(pcbs);
 }
 
 void init(int argc, char **argv)
@@ -545,9 +2644,36 @@ void usage(int status)
 		fprintf(stderr, "Try '%s -h' for more information\n", prgName);
 	else
 	{
-		printf("Usage: %s [-m x] [-d]\n", prgName);
+		printf("Usage: %s [-m x] [-d | -D] [-c file] [-C n] [-r file] [-S n] [-H x]\n       [-N list] [-L list] [-P x[:n]] [-T n] [-Z p[:r[:c:d]]]\n       [-M p[:n]] [-K list] [-R x[:n]]\n       [-t [fmt:]file] [-j file] [-p n[:t]] [-W n[:l:h]]\n       [-s n] [-o file] [-l f[:r]] [-F] [-w t[:n]]\n       [-b n] [-e t] [-n n] [-u n]\n", prgName);
 		printf("     -m x     : Request scheme (1 = RANDOM, 2 = WEIGHTED) (default 1)\n");
 		printf("     -d       : Debug mode (default off)\n");
+		printf("     -D       : Debug mode, dumping only frames changed since the last dump\n");
+		printf("     -c file  : Checkpoint file, written on SIGUSR1 (default %s)\n", PATH_CHECKPOINT);
+		printf("     -C n     : Also write a checkpoint every n simulated seconds\n");
+		printf("     -r file  : Restore and resume the simulation from a checkpoint\n");
+		printf("     -S n     : Share the first n pages of every process, copy-on-write (default 0)\n");
+		printf("     -H x     : Huge pages (1 = on fault and by collapse, 2 = by collapse only) (default off)\n");
+		printf("     -N list  : NUMA node sizes in frames, e.g. 128,128 (default one node of %d)\n", MAX_FRAMES);
+		printf("     -L list  : Node distance matrix row by row, 10 = local speed (default 10 local, 20 remote)\n");
+		printf("     -P x[:n] : Allocation policy (1 = local first, 2 = interleave, 3 = preferred node n) (default 1)\n");
+		printf("     -T n     : Simulate with n worker threads, each with a shard of the frames (default 1)\n");
+		printf("     -Z p[:r[:c:d]] : Compressed tier on p%% of the frames, r pages per frame, c/d us to compress/decompress (default r %.1f, c %d, d %d)\n", ZSWAP_RATIO, ZSWAP_COMPRESS_US, ZSWAP_DECOMPRESS_US);
+		printf("     -M p[:n] : Slow memory tier on p%% of the frames, at distance n from every node (default n %d)\n", TIER_SLOW_DISTANCE);
+		printf("     -K list  : Cache levels as size:ways[:line], L1 first, e.g. %s (default none)\n", CACHE_DEFAULT);
+		printf("     -R x[:n] : Replacement policy (1 = LRU, 2 = aging, ticking every n simulated ms, 3 = clock,\n                4 = switching to whichever of them misses least on sampled pages) (default 1, n %d)\n", AGING_TICK / 1000000);
+		printf("     -t [fmt:]file : Replay a trace instead of running user processes, fmt lackey, csv or bin (default guessed)\n");
+		printf("     -j file  : Also write the wall time breakdown as JSON\n");
+		printf("     -p n[:t] : Keep up to n processes alive at once, spawning t over the run (default %d:%d)\n", PROCESSES_MAX, PROCESSES_TOTAL);
+		printf("     -W n[:l:h] : Free frame watermarks min n, low l, high h, with background reclaim between them (default off)\n");
+		printf("     -s n     : Seed the simulation, so a run can be repeated (default from the time)\n");
+		printf("     -o file  : Also write the run's headline numbers as JSON\n");
+		printf("     -w t[:n] : Estimate working sets every t ms of simulated time, watching one page in each of n regions\n                per process (default off, n %d)\n", WSS_REGIONS);
+		printf("     -b n     : References each process makes before it terminates (default %d)\n", REFERENCE_BUDGET);
+		printf("     -e t     : End the run after t ms of simulated time past the warm-up, instead of after %d real seconds\n", TIMEOUT);
+		printf("     -n n     : End the run after n references past the warm-up, instead of after %d real seconds\n", TIMEOUT);
+		printf("     -u n     : Leave the first n references out of the statistics as a warm-up (default 0)\n");
+		printf("     -F       : Pre-fork a pool of user processes and reuse them across simulated processes\n");
+		printf("     -l f[:r] : Load control, suspending processes while over f%% of accesses fault and memory is short,\n                resuming them below r%% (default off, r f/2)\n");
 	}
 	exit(status);
 }
@@ -567,49 +2693,105 @@ void error(char *fmt, ...)
 
 void registerSgHandler()
 {
-	struct sigaction sa;
-
-	/* Set up SIGINT handler */
-	if (sigemptyset(&sa.sa_mask) == -1)
-		crash("sigemptyset");
-	sa.sa_handler = &sgHandler;
-	sa.sa_flags = SA_RESTART;
-	if (sigaction(SIGINT, &sa, NULL) == -1)
-		crash("sigaction");
+	sigset_t mask;
+	struct epoll_event ev;
 
-	/* Set up SIGALRM handler */
-	if (sigemptyset(&sa.sa_mask) == -1)
+	/* Block the signals oss handles, taking them as events from a signalfd instead; threads started later inherit the mask */
+	if (sigemptyset(&mask) == -1)
 		crash("sigemptyset");
-	sa.sa_handler = &sgHandler;
-	sa.sa_flags = SA_RESTART;
-	if (sigaction(SIGALRM, &sa, NULL) == -1)
-		crash("sigaction");
-
-	/* Initialize timout timer */
-	timer(TIMEOUT);
+	sigaddset(&mask, SIGCHLD);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGALRM);
+	sigaddset(&mask, SIGUSR1);
+	if (sigprocmask(SIG_BLOCK, &mask, &userMask) == -1)
+		crash("sigprocmask");
+	if ((sigFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1)
+		crash("signalfd");
+
+	/* One epoll instance to sleep on while there is nothing to simulate */
+	if ((eventFd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+		crash("epoll_create1");
+	ev.events = EPOLLIN;
+	ev.data.fd = sigFd;
+	if (epoll_ctl(eventFd, EPOLL_CTL_ADD, sigFd, &ev) == -1)
+		crash("epoll_ctl");
+
+	/* Initialize timout timer, unless the run has a simulated length or replays a trace, which make it the same work on every machine */
+	if (runRefs == 0 && runNs == 0 && tracePath == NULL)
+		timer(TIMEOUT);
 
 	signal(SIGSEGV, sgHandler);
 }
 
+/* Only a crash still arrives through a handler, so it just ends the user processes and frees the IPC */
 void sgHandler(int sig)
 {
-	if (sig == SIGALRM)
-		quit = true;
-	else
-	{
-		showSummary();
+	int i;
+	for (i = 0; i < pcbs->capacity; i++)
+		if (pcbOf(pcbs, i) != NULL && pcbOf(pcbs, i)->p_id > 0)
+			kill(pcbOf(pcbs, i)->p_id, SIGTERM);
+	for (i = 0; i < idleCount; i++)
+		kill(idleWorkers[i], SIGTERM);
 
-		/* Kill all running user processes */
-		int i;
-		for (i = 0; i < PROCESSES_MAX; i++)
-			if (pids[i] > 0)
-				kill(pids[i], SIGTERM);
-		while (wait(NULL) > 0)
-			;
+	free_IPC();
+	_exit(EXIT_FAILURE);
+}
+
+/* Handles the signals that arrived, first sleeping until one does when block is set; exited children are reaped in one batch */
+void pollEvents(bool block)
+{
+	struct signalfd_siginfo info[EVENT_BATCH];
+	struct epoll_event ev;
+	bool reap = false;
+	ssize_t n;
+	int i;
+
+	profEnter(PHASE_WAIT);
+	if (block)
+		while (epoll_wait(eventFd, &ev, 1, -1) == -1)
+			if (errno != EINTR)
+				crash("epoll_wait");
+
+	while ((n = read(sigFd, info, sizeof(info))) > 0)
+		for (i = 0; i < n / (ssize_t) sizeof(info[0]); i++)
+		{
+			if (info[i].ssi_signo == SIGCHLD)
+				reap = true;
+			else if (info[i].ssi_signo == SIGALRM)
+				quit = true;
+			else if (info[i].ssi_signo == SIGUSR1)
+				ckptPending = true;
+			else if (info[i].ssi_signo == SIGINT)
+				interrupted = quit = true;
+		}
+	if (n == -1 && errno != EAGAIN)
+		crash("read");
 
-		free_IPC();
-		exit(EXIT_SUCCESS);
+	/* One SIGCHLD can stand for several exits, so take every child that is done, finding each by its PID */
+	pid_t p_id;
+	while (reap && (p_id = waitpid(-1, NULL, WNOHANG)) > 0)
+	{
+		int sp_id = pcbFind(pcbs, p_id);
+		if (sp_id == -1)
+			continue;
+		pcbFree(pcbs, sp_id);
+		act_count--;
+		exit_count++;
 	}
+	profLeave();
+}
+
+/* Ends the user processes still alive after an interrupt, reaping them; idle pool workers are left to stopPool */
+void stopUsers()
+{
+	int i;
+	for (i = 0; i < pcbs->capacity; i++)
+		if (pcbOf(pcbs, i) != NULL && pcbOf(pcbs, i)->p_id > 0)
+		{
+			kill(pcbOf(pcbs, i)->p_id, SIGTERM);
+			while (waitpid(pcbOf(pcbs, i)->p_id, NULL, 0) == -1 && errno == EINTR)
+				;
+		}
 }
 
 void timer(int duration)
@@ -647,23 +2829,402 @@ void init_IPC()
 		crash("semctl");
 }
 
+/* Writes the whole simulator state to the checkpoint file */
+void saveCheckpoint()
+{
+	Checkpoint ckpt;
+	int i;
+
+	ckptOpenWrite(&ckpt, ckptPath);
+	ckptWrite(&ckpt, &schm, sizeof(schm));
+	ckptWrite(&ckpt, &seed, sizeof(seed));
+	ckptWrite(&ckpt, sys, sizeof(System));
+
+	/* Only the processes still running or suspended have PCBs worth keeping */
+	int live = sizeOfQueue(que) + sizeOfQueue(suspended);
+	QueNode *node;
+	ckptWrite(&ckpt, &procMax, sizeof(procMax));
+	ckptWrite(&ckpt, &procTotal, sizeof(procTotal));
+	ckptWrite(&ckpt, &live, sizeof(live));
+	for (node = que->frnt; node != NULL; node = node->nxt)
+	{
+		ckptWrite(&ckpt, &node->indx, sizeof(node->indx));
+		ckptWrite(&ckpt, pcbOf(pcbs, node->indx), sizeof(PCB));
+	}
+	for (node = suspended->frnt; node != NULL; node = node->nxt)
+	{
+		ckptWrite(&ckpt, &node->indx, sizeof(node->indx));
+		ckptWrite(&ckpt, pcbOf(pcbs, node->indx), sizeof(PCB));
+	}
+	ckptWrite(&ckpt, &nxt_spawn, sizeof(nxt_spawn));
+	ckptWrite(&ckpt, &act_count, sizeof(act_count));
+	ckptWrite(&ckpt, &spawn_count, sizeof(spawn_count));
+	ckptWrite(&ckpt, &exit_count, sizeof(exit_count));
+	ckptWrite(&ckpt, memory, sizeof(memory));
+	ckptWrite(&ckpt, frames, sizeof(frames));
+	ckptWrite(&ckpt, &count_mem_acc, sizeof(count_mem_acc));
+	ckptWrite(&ckpt, &count_pg_fault, sizeof(count_pg_fault));
+	ckptWrite(&ckpt, &tot_acc_time, sizeof(tot_acc_time));
+	ckptWrite(&ckpt, &sharedPages, sizeof(sharedPages));
+	ckptWrite(&ckpt, sharedFrm, sizeof(sharedFrm));
+	ckptWrite(&ckpt, &frameCount, sizeof(frameCount));
+	ckptWrite(&ckpt, &nodeCount, sizeof(nodeCount));
+	ckptWrite(&ckpt, nodes, sizeof(nodes));
+	ckptWrite(&ckpt, distance, sizeof(distance));
+	ckptWrite(&ckpt, &numaPolicy, sizeof(numaPolicy));
+	ckptWrite(&ckpt, &preferredNode, sizeof(preferredNode));
+	ckptWrite(&ckpt, &count_local_acc, sizeof(count_local_acc));
+	ckptWrite(&ckpt, &count_remote_acc, sizeof(count_remote_acc));
+	ckptWrite(&ckpt, &count_cow, sizeof(count_cow));
+	ckptWrite(&ckpt, &count_shared_map, sizeof(count_shared_map));
+	ckptWrite(&ckpt, &frames_saved, sizeof(frames_saved));
+	ckptWrite(&ckpt, &peak_frames_saved, sizeof(peak_frames_saved));
+	ckptWrite(&ckpt, &hugeMode, sizeof(hugeMode));
+	ckptWrite(&ckpt, &nxt_scan, sizeof(nxt_scan));
+	ckptWrite(&ckpt, &scanCursor, sizeof(scanCursor));
+	ckptWrite(&ckpt, &count_huge_fault, sizeof(count_huge_fault));
+	ckptWrite(&ckpt, &count_collapse, sizeof(count_collapse));
+	ckptWrite(&ckpt, &count_collapse_fail, sizeof(count_collapse_fail));
+	ckptWrite(&ckpt, &count_split, sizeof(count_split));
+	ckptWrite(&ckpt, &frag_sum, sizeof(frag_sum));
+	ckptWrite(&ckpt, &frag_samples, sizeof(frag_samples));
+	ckptWrite(&ckpt, &tlb->tick, sizeof(tlb->tick));
+	ckptWrite(&ckpt, &tlb->hits, sizeof(tlb->hits));
+	ckptWrite(&ckpt, &tlb->misses, sizeof(tlb->misses));
+	ckptWrite(&ckpt, &tlb->reachSum, sizeof(tlb->reachSum));
+	ckptWrite(&ckpt, tlb->entries, tlb->size * sizeof(TLBEntry));
+	ckptWrite(&ckpt, &zswapFrames, sizeof(zswapFrames));
+	ckptWrite(&ckpt, &zswapCapacity, sizeof(zswapCapacity));
+	ckptWrite(&ckpt, &zswapRatio, sizeof(zswapRatio));
+	ckptWrite(&ckpt, &zswapCompress, sizeof(zswapCompress));
+	ckptWrite(&ckpt, &zswapDecompress, sizeof(zswapDecompress));
+	ckptWrite(&ckpt, &zswapStored, sizeof(zswapStored));
+	ckptWrite(&ckpt, &peak_zswap_stored, sizeof(peak_zswap_stored));
+	ckptWrite(&ckpt, &count_zswap_store, sizeof(count_zswap_store));
+	ckptWrite(&ckpt, &count_zswap_hit, sizeof(count_zswap_hit));
+	ckptWrite(&ckpt, &count_zswap_writeback, sizeof(count_zswap_writeback));
+	ckptWriteList(&ckpt, zswap);
+	ckptWrite(&ckpt, &slowNode, sizeof(slowNode));
+	ckptWrite(&ckpt, &nxt_tier_scan, sizeof(nxt_tier_scan));
+	ckptWrite(&ckpt, &count_fast_acc, sizeof(count_fast_acc));
+	ckptWrite(&ckpt, &count_slow_acc, sizeof(count_slow_acc));
+	ckptWrite(&ckpt, &count_promote, sizeof(count_promote));
+	ckptWrite(&ckpt, &count_demote, sizeof(count_demote));
+	ckptWrite(&ckpt, &cacheCount, sizeof(cacheCount));
+	for (i = 0; i < cacheCount; i++)
+	{
+		ckptWrite(&ckpt, &caches[i]->size, sizeof(caches[i]->size));
+		ckptWrite(&ckpt, &caches[i]->ways, sizeof(caches[i]->ways));
+		ckptWrite(&ckpt, &caches[i]->lineSize, sizeof(caches[i]->lineSize));
+		ckptWrite(&ckpt, &caches[i]->tick, sizeof(caches[i]->tick));
+		ckptWrite(&ckpt, &caches[i]->hits, sizeof(caches[i]->hits));
+		ckptWrite(&ckpt, &caches[i]->misses, sizeof(caches[i]->misses));
+		ckptWrite(&ckpt, caches[i]->lines, caches[i]->sets * caches[i]->ways * sizeof(CacheLine));
+	}
+	ckptWrite(&ckpt, &count_cache_acc, sizeof(count_cache_acc));
+	ckptWrite(&ckpt, &policy, sizeof(policy));
+	ckptWrite(&ckpt, &agePeriod, sizeof(agePeriod));
+	ckptWrite(&ckpt, &nxt_age, sizeof(nxt_age));
+	ckptWrite(&ckpt, ages, sizeof(ages));
+	ckptWrite(&ckpt, frameRef, sizeof(frameRef));
+	ckptWrite(&ckpt, &count_age_tick, sizeof(count_age_tick));
+	ckptWrite(&ckpt, &cache_ns, sizeof(cache_ns));
+	ckptWrite(&ckpt, &wmarkMin, sizeof(wmarkMin));
+	ckptWrite(&ckpt, &wmarkLow, sizeof(wmarkLow));
+	ckptWrite(&ckpt, &wmarkHigh, sizeof(wmarkHigh));
+	ckptWrite(&ckpt, &kswapdAwake, sizeof(kswapdAwake));
+	ckptWrite(&ckpt, &nxt_kswapd, sizeof(nxt_kswapd));
+	ckptWrite(&ckpt, &count_free_alloc, sizeof(count_free_alloc));
+	ckptWrite(&ckpt, &count_direct_reclaim, sizeof(count_direct_reclaim));
+	ckptWrite(&ckpt, &count_kswapd_wake, sizeof(count_kswapd_wake));
+	ckptWrite(&ckpt, &count_kswapd_reclaim, sizeof(count_kswapd_reclaim));
+	ckptWrite(&ckpt, clockRef, sizeof(clockRef));
+	ckptWrite(&ckpt, &clockHand, sizeof(clockHand));
+	ckptWrite(&ckpt, &dueling, sizeof(dueling));
+	ckptWrite(&ckpt, &duelRefs, sizeof(duelRefs));
+	ckptWrite(&ckpt, policyRefs, sizeof(policyRefs));
+	ckptWrite(&ckpt, &count_policy_switch, sizeof(count_policy_switch));
+	for (i = 0; dueling && i < POLICY_ADAPTIVE; i++)
+	{
+		ckptWrite(&ckpt, shadows[i], sizeof(Shadow));
+		ckptWrite(&ckpt, shadows[i]->entries, shadows[i]->capacity * sizeof(ShadowEntry));
+	}
+	ckptWrite(&ckpt, &loadHigh, sizeof(loadHigh));
+	ckptWrite(&ckpt, &loadLow, sizeof(loadLow));
+	ckptWrite(&ckpt, &nxt_load, sizeof(nxt_load));
+	ckptWrite(&ckpt, &load_start, sizeof(load_start));
+	ckptWrite(&ckpt, &load_refs, sizeof(load_refs));
+	ckptWrite(&ckpt, &load_faults, sizeof(load_faults));
+	ckptWrite(&ckpt, &count_suspend, sizeof(count_suspend));
+	ckptWrite(&ckpt, &count_resume, sizeof(count_resume));
+	ckptWrite(&ckpt, &thrash_ns, sizeof(thrash_ns));
+	ckptWrite(&ckpt, &thrash_refs, sizeof(thrash_refs));
+	ckptWrite(&ckpt, &held_ns, sizeof(held_ns));
+	ckptWrite(&ckpt, &held_refs, sizeof(held_refs));
+	ckptWrite(&ckpt, &wssInterval, sizeof(wssInterval));
+	ckptWrite(&ckpt, &wssRegions, sizeof(wssRegions));
+	ckptWrite(&ckpt, &nxt_wss, sizeof(nxt_wss));
+	ckptWrite(&ckpt, &count_wss_pass, sizeof(count_wss_pass));
+	ckptWrite(&ckpt, &wss_sum, sizeof(wss_sum));
+	ckptWrite(&ckpt, &wss_samples, sizeof(wss_samples));
+	ckptWrite(&ckpt, &peak_wss, sizeof(peak_wss));
+	ckptWrite(&ckpt, &wss_hot, sizeof(wss_hot));
+	ckptWrite(&ckpt, &wss_cold, sizeof(wss_cold));
+	ckptWrite(&ckpt, &refBudget, sizeof(refBudget));
+	ckptWrite(&ckpt, &warmup, sizeof(warmup));
+	ckptWrite(&ckpt, &warm, sizeof(warm));
+	ckptWrite(&ckpt, &warm_refs, sizeof(warm_refs));
+	ckptWrite(&ckpt, &warm_ns, sizeof(warm_ns));
+	ckptWrite(&ckpt, &runRefs, sizeof(runRefs));
+	ckptWrite(&ckpt, &runNs, sizeof(runNs));
+	ckptWriteList(&ckpt, stack);
+	ckptWriteQueue(&ckpt, que);
+	ckptWriteQueue(&ckpt, suspended);
+
+	if (ckptClose(&ckpt, ckptPath))
+		flog("Checkpoint written to %s\n", ckptPath);
+	else
+		flog("Failed to write checkpoint %s\n", ckptPath);
+}
+
+/* Loads a checkpoint and restarts its user processes from their saved generator state */
+void restoreCheckpoint()
+{
+	Checkpoint ckpt;
+	int i;
+
+	ckptOpenRead(&ckpt, restorePath);
+	ckptRead(&ckpt, &schm, sizeof(schm));
+	ckptRead(&ckpt, &seed, sizeof(seed));
+	ckptRead(&ckpt, sys, sizeof(System));
+
+	int live = 0;
+	ckptRead(&ckpt, &procMax, sizeof(procMax));
+	ckptRead(&ckpt, &procTotal, sizeof(procTotal));
+	ckptRead(&ckpt, &live, sizeof(live));
+	for (i = 0; ckpt.ok && i < live; i++)
+	{
+		int sp_id = -1;
+		ckptRead(&ckpt, &sp_id, sizeof(sp_id));
+		PCB *pcb = (sp_id >= 0) ? pcbAllocId(pcbs, sp_id) : NULL;
+		if (pcb == NULL)
+		{
+			ckpt.ok = false;
+			break;
+		}
+
+		/* The lock and the PID are this run's, not the saved ones */
+		pthread_mutex_t lock = pcb->lock;
+		ckptRead(&ckpt, pcb, sizeof(PCB));
+		pcb->lock = lock;
+		pcb->p_id = -1;
+	}
+	ckptRead(&ckpt, &nxt_spawn, sizeof(nxt_spawn));
+	ckptRead(&ckpt, &act_count, sizeof(act_count));
+	ckptRead(&ckpt, &spawn_count, sizeof(spawn_count));
+	ckptRead(&ckpt, &exit_count, sizeof(exit_count));
+	ckptRead(&ckpt, memory, sizeof(memory));
+	ckptRead(&ckpt, frames, sizeof(frames));
+	ckptRead(&ckpt, &count_mem_acc, sizeof(count_mem_acc));
+	ckptRead(&ckpt, &count_pg_fault, sizeof(count_pg_fault));
+	ckptRead(&ckpt, &tot_acc_time, sizeof(tot_acc_time));
+	ckptRead(&ckpt, &sharedPages, sizeof(sharedPages));
+	ckptRead(&ckpt, sharedFrm, sizeof(sharedFrm));
+	ckptRead(&ckpt, &frameCount, sizeof(frameCount));
+	ckptRead(&ckpt, &nodeCount, sizeof(nodeCount));
+	ckptRead(&ckpt, nodes, sizeof(nodes));
+	ckptRead(&ckpt, distance, sizeof(distance));
+	ckptRead(&ckpt, &numaPolicy, sizeof(numaPolicy));
+	ckptRead(&ckpt, &preferredNode, sizeof(preferredNode));
+	ckptRead(&ckpt, &count_local_acc, sizeof(count_local_acc));
+	ckptRead(&ckpt, &count_remote_acc, sizeof(count_remote_acc));
+	ckptRead(&ckpt, &count_cow, sizeof(count_cow));
+	ckptRead(&ckpt, &count_shared_map, sizeof(count_shared_map));
+	ckptRead(&ckpt, &frames_saved, sizeof(frames_saved));
+	ckptRead(&ckpt, &peak_frames_saved, sizeof(peak_frames_saved));
+	ckptRead(&ckpt, &hugeMode, sizeof(hugeMode));
+	ckptRead(&ckpt, &nxt_scan, sizeof(nxt_scan));
+	ckptRead(&ckpt, &scanCursor, sizeof(scanCursor));
+	ckptRead(&ckpt, &count_huge_fault, sizeof(count_huge_fault));
+	ckptRead(&ckpt, &count_collapse, sizeof(count_collapse));
+	ckptRead(&ckpt, &count_collapse_fail, sizeof(count_collapse_fail));
+	ckptRead(&ckpt, &count_split, sizeof(count_split));
+	ckptRead(&ckpt, &frag_sum, sizeof(frag_sum));
+	ckptRead(&ckpt, &frag_samples, sizeof(frag_samples));
+	ckptRead(&ckpt, &tlb->tick, sizeof(tlb->tick));
+	ckptRead(&ckpt, &tlb->hits, sizeof(tlb->hits));
+	ckptRead(&ckpt, &tlb->misses, sizeof(tlb->misses));
+	ckptRead(&ckpt, &tlb->reachSum, sizeof(tlb->reachSum));
+	ckptRead(&ckpt, tlb->entries, tlb->size * sizeof(TLBEntry));
+	ckptRead(&ckpt, &zswapFrames, sizeof(zswapFrames));
+	ckptRead(&ckpt, &zswapCapacity, sizeof(zswapCapacity));
+	ckptRead(&ckpt, &zswapRatio, sizeof(zswapRatio));
+	ckptRead(&ckpt, &zswapCompress, sizeof(zswapCompress));
+	ckptRead(&ckpt, &zswapDecompress, sizeof(zswapDecompress));
+	ckptRead(&ckpt, &zswapStored, sizeof(zswapStored));
+	ckptRead(&ckpt, &peak_zswap_stored, sizeof(peak_zswap_stored));
+	ckptRead(&ckpt, &count_zswap_store, sizeof(count_zswap_store));
+	ckptRead(&ckpt, &count_zswap_hit, sizeof(count_zswap_hit));
+	ckptRead(&ckpt, &count_zswap_writeback, sizeof(count_zswap_writeback));
+	ckptReadList(&ckpt, zswap);
+	ckptRead(&ckpt, &slowNode, sizeof(slowNode));
+	ckptRead(&ckpt, &nxt_tier_scan, sizeof(nxt_tier_scan));
+	ckptRead(&ckpt, &count_fast_acc, sizeof(count_fast_acc));
+	ckptRead(&ckpt, &count_slow_acc, sizeof(count_slow_acc));
+	ckptRead(&ckpt, &count_promote, sizeof(count_promote));
+	ckptRead(&ckpt, &count_demote, sizeof(count_demote));
+
+	/* The cache geometry comes from the checkpoint, not from the options of this run */
+	ckptRead(&ckpt, &cacheCount, sizeof(cacheCount));
+	for (i = 0; ckpt.ok && i < cacheCount && i < MAX_CACHES; i++)
+	{
+		int size, ways, line;
+		ckptRead(&ckpt, &size, sizeof(size));
+		ckptRead(&ckpt, &ways, sizeof(ways));
+		ckptRead(&ckpt, &line, sizeof(line));
+		if (!ckpt.ok || ways <= 0 || line <= 0 || size <= 0 || size % (ways * line) != 0)
+			break;
+		caches[i] = newCache(size, ways, line);
+		ckptRead(&ckpt, &caches[i]->tick, sizeof(caches[i]->tick));
+		ckptRead(&ckpt, &caches[i]->hits, sizeof(caches[i]->hits));
+		ckptRead(&ckpt, &caches[i]->misses, sizeof(caches[i]->misses));
+		ckptRead(&ckpt, caches[i]->lines, caches[i]->sets * caches[i]->ways * sizeof(CacheLine));
+	}
+	if (i < cacheCount)
+	{
+		ckpt.ok = false;
+		cacheCount = 0;
+	}
+	ckptRead(&ckpt, &count_cache_acc, sizeof(count_cache_acc));
+	ckptRead(&ckpt, &policy, sizeof(policy));
+	ckptRead(&ckpt, &agePeriod, sizeof(agePeriod));
+	ckptRead(&ckpt, &nxt_age, sizeof(nxt_age));
+	ckptRead(&ckpt, ages, sizeof(ages));
+	ckptRead(&ckpt, frameRef, sizeof(frameRef));
+	ckptRead(&ckpt, &count_age_tick, sizeof(count_age_tick));
+	ckptRead(&ckpt, &cache_ns, sizeof(cache_ns));
+	ckptRead(&ckpt, &wmarkMin, sizeof(wmarkMin));
+	ckptRead(&ckpt, &wmarkLow, sizeof(wmarkLow));
+	ckptRead(&ckpt, &wmarkHigh, sizeof(wmarkHigh));
+	ckptRead(&ckpt, &kswapdAwake, sizeof(kswapdAwake));
+	ckptRead(&ckpt, &nxt_kswapd, sizeof(nxt_kswapd));
+	ckptRead(&ckpt, &count_free_alloc, sizeof(count_free_alloc));
+	ckptRead(&ckpt, &count_direct_reclaim, sizeof(count_direct_reclaim));
+	ckptRead(&ckpt, &count_kswapd_wake, sizeof(count_kswapd_wake));
+	ckptRead(&ckpt, &count_kswapd_reclaim, sizeof(count_kswapd_reclaim));
+	ckptRead(&ckpt, clockRef, sizeof(clockRef));
+	ckptRead(&ckpt, &clockHand, sizeof(clockHand));
+	ckptRead(&ckpt, &dueling, sizeof(dueling));
+	ckptRead(&ckpt, &duelRefs, sizeof(duelRefs));
+	ckptRead(&ckpt, policyRefs, sizeof(policyRefs));
+	ckptRead(&ckpt, &count_policy_switch, sizeof(count_policy_switch));
+
+	/* Like the cache geometry, the shadows come from the checkpoint */
+	for (i = 0; ckpt.ok && dueling && i < POLICY_ADAPTIVE; i++)
+	{
+		Shadow copy;
+		ckptRead(&ckpt, &copy, sizeof(Shadow));
+		if (!ckpt.ok || copy.capacity <= 0 || copy.count > copy.capacity)
+		{
+			ckpt.ok = false;
+			break;
+		}
+		shadows[i] = newShadow(copy.policy, copy.capacity, copy.agePeriod);
+		copy.entries = shadows[i]->entries;
+		*shadows[i] = copy;
+		ckptRead(&ckpt, shadows[i]->entries, copy.capacity * sizeof(ShadowEntry));
+	}
+	ckptRead(&ckpt, &loadHigh, sizeof(loadHigh));
+	ckptRead(&ckpt, &loadLow, sizeof(loadLow));
+	ckptRead(&ckpt, &nxt_load, sizeof(nxt_load));
+	ckptRead(&ckpt, &load_start, sizeof(load_start));
+	ckptRead(&ckpt, &load_refs, sizeof(load_refs));
+	ckptRead(&ckpt, &load_faults, sizeof(load_faults));
+	ckptRead(&ckpt, &count_suspend, sizeof(count_suspend));
+	ckptRead(&ckpt, &count_resume, sizeof(count_resume));
+	ckptRead(&ckpt, &thrash_ns, sizeof(thrash_ns));
+	ckptRead(&ckpt, &thrash_refs, sizeof(thrash_refs));
+	ckptRead(&ckpt, &held_ns, sizeof(held_ns));
+	ckptRead(&ckpt, &held_refs, sizeof(held_refs));
+	ckptRead(&ckpt, &wssInterval, sizeof(wssInterval));
+	ckptRead(&ckpt, &wssRegions, sizeof(wssRegions));
+	ckptRead(&ckpt, &nxt_wss, sizeof(nxt_wss));
+	ckptRead(&ckpt, &count_wss_pass, sizeof(count_wss_pass));
+	ckptRead(&ckpt, &wss_sum, sizeof(wss_sum));
+	ckptRead(&ckpt, &wss_samples, sizeof(wss_samples));
+	ckptRead(&ckpt, &peak_wss, sizeof(peak_wss));
+	ckptRead(&ckpt, &wss_hot, sizeof(wss_hot));
+	ckptRead(&ckpt, &wss_cold, sizeof(wss_cold));
+	ckptRead(&ckpt, &refBudget, sizeof(refBudget));
+	ckptRead(&ckpt, &warmup, sizeof(warmup));
+	ckptRead(&ckpt, &warm, sizeof(warm));
+	ckptRead(&ckpt, &warm_refs, sizeof(warm_refs));
+	ckptRead(&ckpt, &warm_ns, sizeof(warm_ns));
+	ckptRead(&ckpt, &runRefs, sizeof(runRefs));
+	ckptRead(&ckpt, &runNs, sizeof(runNs));
+	ckptReadList(&ckpt, stack);
+	ckptReadQueue(&ckpt, que);
+	ckptReadQueue(&ckpt, suspended);
+
+	if (!ckptClose(&ckpt, NULL))
+	{
+		error("cannot restore checkpoint '%s'", restorePath);
+		exit(EXIT_FAILURE);
+	}
+
+	/* The run length comes from the checkpoint as well, so the timeout follows it */
+	timer((runRefs > 0 || runNs > 0) ? 0 : TIMEOUT);
+	memcpy(dumped, frames, sizeof(frames));
+
+	/* Processes that had terminated but were not yet reaped are done, so count them as exited */
+	act_count = sizeOfQueue(que) + sizeOfQueue(suspended);
+	exit_count = spawn_count - act_count;
+
+	QueNode *node;
+	for (node = que->frnt; node != NULL; node = node->nxt)
+	{
+		PCB *pcb = pcbOf(pcbs, node->indx);
+		startUser(node->indx, pcb->seed, pcb->refs);
+	}
+	for (node = suspended->frnt; node != NULL; node = node->nxt)
+	{
+		PCB *pcb = pcbOf(pcbs, node->indx);
+		startUser(node->indx, pcb->seed, pcb->refs);
+	}
+
+	flog("Restored checkpoint %s with %d processes\n", restorePath, act_count);
+}
+
+/* IPC IDs can be 0, so only -1 means there is nothing to remove; each is cleared once removed */
 void free_IPC()
 {
-	if (sys != NULL && shmdt(sys) == -1)
+	System *attached = sys;
+	int shm = shm_id, msq = msq_id, sem = semid;
+
+	sys = NULL;
+	shm_id = msq_id = semid = -1;
+
+	if (attached != NULL && shmdt(attached) == -1)
 		crash("shmdt");
-	if (shm_id > 0 && shmctl(shm_id, IPC_RMID, NULL) == -1)
+	if (shm != -1 && shmctl(shm, IPC_RMID, NULL) == -1)
 		crash("shmdt");
 
-	if (msq_id > 0 && msgctl(msq_id, IPC_RMID, NULL) == -1)
+	if (msq != -1 && msgctl(msq, IPC_RMID, NULL) == -1)
 		crash("msgctl");
 
-	if (semid > 0 && semctl(semid, 0, IPC_RMID) == -1)
+	if (sem != -1 && semctl(sem, 0, IPC_RMID) == -1)
 		crash("semctl");
 }
 
+/* Returns the simulated clock in nanoseconds */
+unsigned long long clockNs()
+{
+	return (unsigned long long) sys->clock.s * 1000000000ULL + sys->clock.ns;
+}
+
 int clckAvance(int ns)
 {
-	int r = (ns > 0) ? ns : rand() % (1 * 1000) + 1;
+	int r = (ns > 0) ? ns : rand_r(rng) % (1 * 1000) + 1;
 
 	/* Increment sys clock by random nanoseconds */
 	sem_lock(0);
@@ -697,19 +3258,152 @@ void sem_lock(const int indx)
 		crash("semop");
 }
 
+/* Writes the numbers the benchmark suite tracks as one JSON object */
+void writeMetrics(FILE *fp)
+{
+	struct rusage usage;
+	double wall = profWall() / 1e9;
+	int refs = count_mem_acc;
+	int faults = count_pg_fault;
+
+	if (getrusage(RUSAGE_SELF, &usage) == -1)
+		crash("getrusage");
+
+	fprintf(fp, "{\"refs\": %d, \"faults\": %d, \"fault_ratio\": %f, \"refs_per_sec\": %f, \"sim_access_ms\": %f, \"peak_rss_kb\": %ld, \"wall_s\": %f, \"sim_s\": %f, \"processes\": %d}\n",
+		refs, faults, (double) faults / (double) refs, (double) refs / wall,
+		((double) tot_acc_time / (double) refs) / 1000000.0, usage.ru_maxrss, wall, (clockNs() - warm_ns) / 1e9, spawn_count);
+}
+
 void showSummary() {
-	double mem_access_per_sec = (double) count_mem_acc / (double) sys->clock.s;
-	double pg_faults_per_mem_acc = (double) count_pg_fault / (double) count_mem_acc;
-	double avg_mem_acc_speed = ((double) tot_acc_time / (double) count_mem_acc) / (double) 1000000;
+	/* The statistics were reset as the warm-up ended, only its time is taken off here */
+	int refs = count_mem_acc;
+	int faults = count_pg_fault;
+	double mem_access_per_sec = (double) refs / ((clockNs() - warm_ns) / 1e9);
+	double pg_faults_per_mem_acc = (double) faults / (double) refs;
+	double avg_mem_acc_speed = ((double) tot_acc_time / (double) refs) / (double) 1000000;
 
 	log("\n <<< << STATISTICS >>  >>>\n");
 	log(" ___________________________________________");
 
 	log("/n Total memory accesses per second: %f\n", mem_access_per_sec);
 	log("\n Total page faults per memory access: %f\n", pg_faults_per_mem_acc);
-	log("\n Total page fault count: %d\n", count_pg_fault);
-	log("\n Total memory access count: %d\n", count_mem_acc);
+	log("\n Total page fault count: %d\n", faults);
+	log("\n Total memory access count: %d\n", refs);
 	log("\n Total processes executed: %d\n", spawn_count);
+	if (warmup > 0 && warm)
+		log("\n Warm-up: %d references and %f simulated seconds left out of the statistics\n", warm_refs, warm_ns / 1e9);
+	else if (warmup > 0)
+		log("\n Warm-up: never ended, the run stopped after %d of its %d references, so the totals include them\n", count_mem_acc, warmup);
+	log("\n Frame allocations served from free memory: %d, by direct reclaim: %d (%f)\n", count_free_alloc, count_direct_reclaim,
+		(double) count_direct_reclaim / (double) (count_free_alloc + count_direct_reclaim));
+	if (wssInterval > 0)
+	{
+		log("\n Working-set sampling: %d passes, average estimate %f pages per process, peak total %d pages of %d frames\n",
+			count_wss_pass, wss_samples > 0 ? wss_sum / wss_samples : 0.0, peak_wss, frameCount);
+		log("\n Cold memory: %f percent of sampled resident pages\n", wss_hot + wss_cold > 0 ? wss_cold * 100 / (wss_hot + wss_cold) : 0.0);
+	}
+	if (pooled)
+		log("\n Worker pool: %d user processes served %d simulated processes\n", poolSize, count_pool_assign);
+	if (loadHigh > 0)
+	{
+		log("\n Load control: %d suspensions, %d resumptions\n", count_suspend, count_resume);
+		log("\n Throughput while thrashing: %f references/s, with processes suspended: %f references/s\n",
+			thrash_ns > 0 ? thrash_refs / (thrash_ns / 1e9) : 0.0, held_ns > 0 ? held_refs / (held_ns / 1e9) : 0.0);
+	}
+	if (wmarkMin > 0)
+	{
+		log("\n Watermarks: min %d, low %d, high %d free frames\n", wmarkMin, wmarkLow, wmarkHigh);
+		log("\n Background reclaim: woken %d times, %d pages reclaimed\n", count_kswapd_wake, count_kswapd_reclaim);
+	}
+	if (sharedPages > 0)
+	{
+		log("\n Shared page mappings: %d\n", count_shared_map);
+		log("\n Frames saved by sharing: %d now, %d peak\n", frames_saved, peak_frames_saved);
+		log("\n Copy-on-write faults: %d (counted in the page faults)\n", count_cow);
+	}
+	if (nodeCount > 1)
+	{
+		int i;
+		for (i = 0; i < nodeCount; i++)
+			log("\n Node %d: frames %d-%d\n", i, nodes[i].base, nodes[i].base + nodes[i].size - 1);
+		log("\n Local memory accesses: %d\n", count_local_acc);
+		log("\n Remote memory accesses: %d\n", count_remote_acc);
+		log("\n Local access ratio: %f\n", (double) count_local_acc / (double) (count_local_acc + count_remote_acc));
+	}
+
+	/* Every worker has its own TLB, so add them up */
+	int tlbHits = tlb->hits, tlbMisses = tlb->misses;
+	double reachSum = tlb->reachSum;
+	if (threads > 1)
+	{
+		int i;
+		for (i = 0; i < threads; i++)
+		{
+			tlbHits += workers[i].tlb->hits;
+			tlbMisses += workers[i].tlb->misses;
+			reachSum += workers[i].tlb->reachSum;
+		}
+		log("\n Worker threads: %d\n", threads);
+		log("\n Frames stolen from other shards: %d\n", count_steal);
+		log("\n Batched LRU updates applied: %d times\n", count_drain);
+	}
+	log("\n TLB hit ratio: %f\n", (double) tlbHits / (double) (tlbHits + tlbMisses));
+	log("\n Average TLB reach: %f KB\n", reachSum / (double) (tlbHits + tlbMisses) * PAGE_SIZE / 1000.0);
+	if (hugeMode != HUGE_NEVER)
+	{
+		log("\n Huge page faults: %d\n", count_huge_fault);
+		log("\n Huge page collapses: %d (%d failed for lack of a free run)\n", count_collapse, count_collapse_fail);
+		log("\n Huge page splits: %d\n", count_split);
+		log("\n Average free memory fragmentation: %f\n", frag_samples > 0 ? frag_sum / frag_samples : 0.0);
+	}
+	if (zswapFrames > 0)
+	{
+		log("\n Compressed tier: %d frames holding up to %d pages\n", zswapFrames, zswapCapacity);
+		log("\n Pages compressed: %d, written back to disk: %d\n", count_zswap_store, count_zswap_writeback);
+		log("\n Page faults served by the compressed tier: %d (%f of faults)\n", count_zswap_hit, (double) count_zswap_hit / (double) count_pg_fault);
+		log("\n Effective memory expansion: %f (peak)\n", (double) (frameCount + peak_zswap_stored) / (double) (frameCount + zswapFrames));
+	}
+	if (tracePath != NULL)
+		log("\n Trace references replayed: %ld (%ld other lines skipped)\n", trace.refs, trace.skipped);
+	if (policy == POLICY_AGING || dueling)
+		log("\n Aging ticks: %d, every %llu ms\n", count_age_tick, agePeriod / 1000000);
+	if (dueling)
+	{
+		int i;
+		log("\n Replacement policy switches: %d, ending on %s\n", count_policy_switch, policyNames[policy]);
+		for (i = 0; i < POLICY_ADAPTIVE; i++)
+			log("\n Shadow %s miss ratio: %f, references served under %s: %d\n", policyNames[i],
+				(double) shadows[i]->misses / (double) (shadows[i]->hits + shadows[i]->misses), policyNames[i], policyRefs[i]);
+	}
+	if (cacheCount > 0)
+	{
+		int i;
+		for (i = 0; i < cacheCount; i++)
+		{
+			Cache *c = caches[i];
+			log("\n %s (%d bytes, %d-way, %d byte lines, %d page colors) miss rate: %f\n", (i == cacheCount - 1) ? "LLC" : (i == 0) ? "L1" : "L2",
+				c->size, c->ways, c->lineSize, cacheColors(c, 1 << PAGE_SHIFT), (double) c->misses / (double) (c->hits + c->misses));
+		}
+		log("\n Cache average memory access time: %f ns\n", (double) cache_ns / (double) count_cache_acc);
+	}
+	if (slowNode != -1)
+	{
+		log("\n Fast tier hit ratio: %f\n", (double) count_fast_acc / (double) (count_fast_acc + count_slow_acc));
+		log("\n Slow tier hit ratio: %f\n", (double) count_slow_acc / (double) (count_fast_acc + count_slow_acc));
+		log("\n Tier migrations: %d promotions, %d demotions\n", count_promote, count_demote);
+	}
+
+	/* Where the wall time went; with threads, phase times add up over all of them */
+	unsigned long long wall = profWall(), profiled = 0;
+	int phase;
+	log("\n Wall time: %f s\n", wall / 1e9);
+	for (phase = 0; phase < PHASE_COUNT; phase++)
+	{
+		log("   %-8s %10.6f s %6.2f%% (%llu calls)\n", profName(phase), profTime(phase) / 1e9, 100.0 * profTime(phase) / wall, profCalls(phase));
+		profiled += profTime(phase);
+	}
+	if (threads == 1)
+		log("   %-8s %10.6f s %6.2f%%\n", "other", (wall - profiled) / 1e9, 100.0 * (wall - profiled) / wall);
 	log(" ___________________________________________");
 	log(">>\n SYSTEM TIME << : %d.%d\n", sys->clock.s, sys->clock.ns);
 	
@@ -722,14 +3416,27 @@ void showSummary() {
 
 void showMemoryMap()
 {
+	int i, resident = 0, dirty = 0;
+
 	if (!debug)
 		return;
-	log("\n");
-	/* Log the reference list */
-	log(listString(rfrnce));
-	/* Log the stack list */
-	log(listString(stack));
-	log("\n");
+
+	/* Stream the frame table and the LRU stack straight into the log */
+	dumpf(&dump, "\n");
+	if (debugDiff)
+		dumpFramesDiff(&dump, frames, dumped, frameCount);
+	else
+		dumpFrames(&dump, frames, frameCount);
+	dumpList(&dump, stack);
+	for (i = 0; i < pcbs->capacity; i++)
+		if (pcbOf(pcbs, i) != NULL)
+		{
+			resident += bitmapCount(pcbOf(pcbs, i)->valid, PT_WORDS);
+			dirty += bitmapCount(pcbOf(pcbs, i)->dirty, PT_WORDS);
+		}
+	dumpf(&dump, "Resident pages: %d, dirty: %d\n", resident, dirty);
+	dumpf(&dump, "\n");
+	dumpFlush(&dump);
 }
 
 void sem_unlock(const int indx)
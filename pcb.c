@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcb.h"
+
+static int hashPid(const PcbTable *table, pid_t p_id)
+{
+	return (unsigned int) p_id * 2654435761u & (table->capacity - 1);
+}
+
+static void unhash(PcbTable *table, int sp_id)
+{
+	int *link = &table->buckets[hashPid(table, table->slots[sp_id]->p_id)];
+
+	while (*link != -1 && *link != sp_id)
+		link = &table->chain[*link];
+	if (*link == sp_id)
+		*link = table->chain[sp_id];
+}
+
+static void rehash(PcbTable *table, int sp_id)
+{
+	int *head = &table->buckets[hashPid(table, table->slots[sp_id]->p_id)];
+
+	table->chain[sp_id] = *head;
+	*head = sp_id;
+}
+
+/* Resizes the table, pushing the new slots so the free stack hands them out lowest first */
+static void resize(PcbTable *table, int capacity)
+{
+	int old = table->capacity;
+	int i;
+
+	table->slots = (PCB**) realloc(table->slots, capacity * sizeof(PCB*));
+	table->freeIds = (int*) realloc(table->freeIds, capacity * sizeof(int));
+	table->buckets = (int*) realloc(table->buckets, capacity * sizeof(int));
+	table->chain = (int*) realloc(table->chain, capacity * sizeof(int));
+	table->capacity = capacity;
+
+	for (i = capacity - 1; i >= old; i--)
+	{
+		table->slots[i] = NULL;
+		table->freeIds[table->freeCount++] = i;
+	}
+
+	/* The hash is sized with the table, so every chain is rebuilt */
+	for (i = 0; i < capacity; i++)
+		table->buckets[i] = -1;
+	for (i = 0; i < old; i++)
+		if (table->slots[i] != NULL && table->slots[i]->p_id > 0)
+			rehash(table, i);
+}
+
+/* Capacity is rounded up to a power of two, as the PID hash masks with it */
+PcbTable *newPcbTable(int capacity)
+{
+	PcbTable *table = (PcbTable*) malloc(sizeof(PcbTable));
+	int size = 1;
+
+	while (size < capacity)
+		size *= 2;
+
+	table->slots = NULL;
+	table->freeIds = NULL;
+	table->buckets = NULL;
+	table->chain = NULL;
+	table->capacity = 0;
+	table->freeCount = 0;
+	table->live = 0;
+	resize(table, size);
+	return table;
+}
+
+static PCB *newPCB(int sp_id)
+{
+	PCB *pcb = (PCB*) calloc(1, sizeof(PCB));
+	pcb->p_id = -1;
+	pcb->sp_id = sp_id;
+	pthread_mutex_init(&pcb->lock, NULL);
+	return pcb;
+}
+
+/* Takes the simulated PID on top of the free stack, growing the table when none is left, and gives it a zeroed PCB */
+int pcbAlloc(PcbTable *table)
+{
+	if (table->freeCount == 0)
+		resize(table, table->capacity * 2);
+
+	int sp_id = table->freeIds[--table->freeCount];
+	table->slots[sp_id] = newPCB(sp_id);
+	table->live++;
+	return sp_id;
+}
+
+/* Allocates one particular simulated PID, as when restoring a checkpoint; NULL if it is taken */
+PCB *pcbAllocId(PcbTable *table, int sp_id)
+{
+	int i;
+
+	while (sp_id >= table->capacity)
+		resize(table, table->capacity * 2);
+	if (table->slots[sp_id] != NULL)
+		return NULL;
+
+	for (i = 0; i < table->freeCount; i++)
+		if (table->freeIds[i] == sp_id)
+		{
+			memmove(&table->freeIds[i], &table->freeIds[i + 1], (table->freeCount - i - 1) * sizeof(int));
+			table->freeCount--;
+			break;
+		}
+
+	table->slots[sp_id] = newPCB(sp_id);
+	table->live++;
+	return table->slots[sp_id];
+}
+
+/* Releases a PCB along with its page table, and puts its simulated PID back on the free stack */
+void pcbFree(PcbTable *table, int sp_id)
+{
+	PCB *pcb = table->slots[sp_id];
+
+	if (pcb == NULL)
+		return;
+	if (pcb->p_id > 0)
+		unhash(table, sp_id);
+	pthread_mutex_destroy(&pcb->lock);
+	free(pcb);
+
+	table->slots[sp_id] = NULL;
+	table->freeIds[table->freeCount++] = sp_id;
+	table->live--;
+}
+
+/* Records the PID a simulated process runs as, so it can be found when it exits */
+void pcbSetPid(PcbTable *table, int sp_id, pid_t p_id)
+{
+	PCB *pcb = table->slots[sp_id];
+
+	if (pcb->p_id > 0)
+		unhash(table, sp_id);
+	pcb->p_id = p_id;
+	if (p_id > 0)
+		rehash(table, sp_id);
+}
+
+/* Returns the simulated PID of a PID, otherwise -1 for not found */
+int pcbFind(const PcbTable *table, pid_t p_id)
+{
+	int sp_id = table->buckets[hashPid(table, p_id)];
+
+	while (sp_id != -1 && table->slots[sp_id]->p_id != p_id)
+		sp_id = table->chain[sp_id];
+	return sp_id;
+}
@@ -0,0 +1,29 @@
+#ifndef PCB_H
+#define PCB_H
+
+#include <sys/types.h>
+
+#include "shared.h"
+
+/* Process table that grows on demand, with a free-slot stack for simulated PIDs and a hash from PID to slot */
+typedef struct {
+	PCB **slots;	/* Indexed by simulated PID, NULL for a free slot */
+	int capacity;
+	int *freeIds;	/* Free simulated PIDs, the nxt one to hand out on top */
+	int freeCount;
+	int *buckets;	/* First slot of each PID hash chain, -1 when empty */
+	int *chain;	/* Nxt slot in the same hash chain */
+	int live;
+} PcbTable;
+
+/* The PCB of a simulated PID, NULL when the slot is free */
+#define pcbOf(table, sp_id) ((table)->slots[sp_id])
+
+PcbTable *newPcbTable(int);
+int pcbAlloc(PcbTable*);
+PCB *pcbAllocId(PcbTable*, int);
+void pcbFree(PcbTable*, int);
+void pcbSetPid(PcbTable*, int, pid_t);
+int pcbFind(const PcbTable*, pid_t);
+
+#endif
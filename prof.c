@@ -0,0 +1,122 @@
+#include <time.h>
+
+#include "prof.h"
+
+static const char *names[PHASE_COUNT] = { "ipc", "fault", "replace", "log", "spawn", "wait" };
+
+/* Time is exclusive: a phase stops counting while one nested inside it runs */
+static unsigned long long spent[PHASE_COUNT];
+static unsigned long long calls[PHASE_COUNT];
+static unsigned long long wallStart = 0;
+static unsigned long long wallEnd = 0;
+
+static __thread int stack[PROF_DEPTH];
+static __thread unsigned long long since[PROF_DEPTH];
+static __thread int depth = 0;
+
+static unsigned long long now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Once stopped, the breakdown stays as it was, so printing it does not show up in it */
+static void charge(int phase, unsigned long long ns)
+{
+	if (wallEnd == 0)
+		__atomic_add_fetch(&spent[phase], ns, __ATOMIC_RELAXED);
+}
+
+void profStart()
+{
+	wallStart = now();
+	wallEnd = 0;
+}
+
+/* Starts the breakdown over, as if the run began now; phases open on this thread count from here */
+void profReset()
+{
+	unsigned long long t = now();
+	int i;
+
+	for (i = 0; i < PHASE_COUNT; i++)
+	{
+		__atomic_store_n(&spent[i], 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&calls[i], 0, __ATOMIC_RELAXED);
+	}
+	for (i = 0; i < depth; i++)
+		since[i] = t;
+	wallStart = t;
+}
+
+void profStop()
+{
+	wallEnd = now();
+}
+
+void profEnter(int phase)
+{
+	unsigned long long t = now();
+
+	if (depth == PROF_DEPTH)
+		return;
+	if (depth > 0)
+		charge(stack[depth - 1], t - since[depth - 1]);
+	stack[depth] = phase;
+	since[depth] = t;
+	depth++;
+	if (wallEnd == 0)
+		__atomic_add_fetch(&calls[phase], 1, __ATOMIC_RELAXED);
+}
+
+void profLeave()
+{
+	unsigned long long t = now();
+
+	if (depth == 0)
+		return;
+	depth--;
+	charge(stack[depth], t - since[depth]);
+	if (depth > 0)
+		since[depth - 1] = t;
+}
+
+/* Wall time of the run so far, or of the whole run once stopped */
+unsigned long long profWall()
+{
+	if (wallStart == 0)
+		return 0;
+	return ((wallEnd != 0) ? wallEnd : now()) - wallStart;
+}
+
+unsigned long long profTime(int phase)
+{
+	return __atomic_load_n(&spent[phase], __ATOMIC_RELAXED);
+}
+
+unsigned long long profCalls(int phase)
+{
+	return __atomic_load_n(&calls[phase], __ATOMIC_RELAXED);
+}
+
+const char *profName(int phase)
+{
+	return names[phase];
+}
+
+/* Writes the breakdown as one JSON object; with threads, phase times add up over all of them */
+void profJson(FILE *fp, int threads)
+{
+	unsigned long long wall = profWall();
+	unsigned long long sum = 0;
+	int i;
+
+	fprintf(fp, "{\"wall_ns\": %llu, \"threads\": %d, \"phases\": {", wall, threads);
+	for (i = 0; i < PHASE_COUNT; i++)
+	{
+		fprintf(fp, "%s\"%s\": {\"ns\": %llu, \"calls\": %llu}", (i > 0) ? ", " : "", names[i], profTime(i), profCalls(i));
+		sum += profTime(i);
+	}
+	fprintf(fp, "}, \"other_ns\": %llu}\n", (threads == 1 && wall > sum) ? wall - sum : 0);
+}
@@ -0,0 +1,21 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdio.h>
+
+#define PROF_DEPTH 8	/* Phases that can be nested inside each other */
+
+enum Phase { PHASE_IPC, PHASE_FAULT, PHASE_REPLACE, PHASE_LOG, PHASE_SPAWN, PHASE_WAIT, PHASE_COUNT };
+
+void profStart();
+void profReset();
+void profStop();
+void profEnter(int);
+void profLeave();
+unsigned long long profWall();
+unsigned long long profTime(int);
+unsigned long long profCalls(int);
+const char *profName(int);
+void profJson(FILE*, int);
+
+#endif
@@ -32,14 +32,13 @@ void enqueue(Que *que, int indx) {
 	que->tail = temp;
 }
 
-QueNode *dequeue(Que *que) {
-	if (que->frnt == NULL) return NULL;
+void dequeue(Que *que) {
+	if (que->frnt == NULL) return;
 	QueNode *temp = que->frnt;
-	free(temp);
 	que->frnt = que->frnt->nxt;
+	free(temp);
 	if (que->frnt == NULL) que->tail = NULL;
 	que->count--;
-	return temp;
 }
 
 void removeFromQueue(Que *que, int indx) {
@@ -17,7 +17,7 @@ typedef struct {
 Que *newQueue();
 QueNode *makeQueueNode(int);
 void enqueue(Que*, int);
-QueNode *dequeue(Que*);
+void dequeue(Que*);
 void removeFromQueue(Que*, int);
 bool isQueueEmpty(Que*);
 int sizeOfQueue(Que*);
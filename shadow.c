@@ -0,0 +1,106 @@
+#include <stdlib.h>
+
+#include "shadow.h"
+#include "shared.h"
+
+Shadow *newShadow(int policy, int capacity, unsigned long long agePeriod)
+{
+	Shadow *shadow = (Shadow*) malloc(sizeof(Shadow));
+	shadow->entries = (ShadowEntry*) calloc(capacity, sizeof(ShadowEntry));
+	shadow->policy = policy;
+	shadow->capacity = capacity;
+	shadow->count = 0;
+	shadow->hand = 0;
+	shadow->tick = 0;
+	shadow->agePeriod = agePeriod;
+	shadow->nxtAge = agePeriod;
+	shadow->hits = 0;
+	shadow->misses = 0;
+	shadow->winMisses = 0;
+	shadow->missRate = -1;
+	return shadow;
+}
+
+/* Shifts every referenced bit into its counter, as the live aging tick does */
+static void ageTickShadow(Shadow *shadow)
+{
+	int i;
+
+	for (i = 0; i < shadow->count; i++)
+	{
+		ShadowEntry *entry = &shadow->entries[i];
+		entry->age = (entry->age >> 1) | (entry->ref ? 0x80 : 0);
+		entry->ref = false;
+	}
+}
+
+static int victimOf(Shadow *shadow)
+{
+	int victim = 0;
+	int i;
+
+	if (shadow->policy == POLICY_CLOCK)
+	{
+		/* Second chance: the hand clears referenced bits until it meets an entry without one */
+		while (shadow->entries[shadow->hand].ref)
+		{
+			shadow->entries[shadow->hand].ref = false;
+			shadow->hand = (shadow->hand + 1) % shadow->capacity;
+		}
+		victim = shadow->hand;
+		shadow->hand = (shadow->hand + 1) % shadow->capacity;
+		return victim;
+	}
+
+	for (i = 1; i < shadow->count; i++)
+	{
+		ShadowEntry *entry = &shadow->entries[i];
+		if (shadow->policy == POLICY_AGING ? entry->age < shadow->entries[victim].age : entry->used < shadow->entries[victim].used)
+			victim = i;
+	}
+	return victim;
+}
+
+/* Looks a page up, replacing an entry the way the policy would on a miss; returns whether it hit. The tables are small, so a scan does */
+bool shadowAccess(Shadow *shadow, uint32_t key, unsigned long long now)
+{
+	ShadowEntry *entry;
+	int i;
+
+	shadow->tick++;
+	if (shadow->policy == POLICY_AGING && now >= shadow->nxtAge)
+	{
+		ageTickShadow(shadow);
+		shadow->nxtAge = now + shadow->agePeriod;
+	}
+
+	for (i = 0; i < shadow->count; i++)
+	{
+		entry = &shadow->entries[i];
+		if (entry->key == key)
+		{
+			entry->used = shadow->tick;
+			entry->ref = true;
+			shadow->hits++;
+			return true;
+		}
+	}
+
+	shadow->misses++;
+	shadow->winMisses++;
+	entry = &shadow->entries[(shadow->count < shadow->capacity) ? shadow->count++ : victimOf(shadow)];
+	entry->key = key;
+	entry->used = shadow->tick;
+	entry->age = AGE_NEW;
+	entry->ref = true;
+	return false;
+}
+
+/* Closes a window of refs sampled references, folding its miss ratio into the running one */
+void shadowWindow(Shadow *shadow, int refs)
+{
+	double rate = (double) shadow->winMisses / (double) refs;
+
+	shadow->missRate = (shadow->missRate < 0) ? rate : (shadow->missRate + rate) / 2;
+	shadow->winMisses = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+	uint32_t key;
+	unsigned long used;	/* Tick of the last access, for LRU */
+	uint8_t age;	/* Aging counter */
+	bool ref;	/* Referenced since the last aging tick or pass of the clock hand */
+} ShadowEntry;
+
+/* Ghost copy of a replacement policy: page keys and policy metadata only, no frames behind them */
+typedef struct Shadow {
+	ShadowEntry *entries;
+	int policy;
+	int capacity;
+	int count;	/* Entries in use */
+	int hand;	/* Clock hand */
+	unsigned long tick;
+	unsigned long long agePeriod;
+	unsigned long long nxtAge;
+	int hits;
+	int misses;
+	int winMisses;	/* Misses in the current window */
+	double missRate;	/* Miss ratio of past windows, each weighing half the one after it */
+} Shadow;
+
+Shadow *newShadow(int, int, unsigned long long);
+bool shadowAccess(Shadow*, uint32_t, unsigned long long);
+void shadowWindow(Shadow*, int);
+
+#endif
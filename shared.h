@@ -1,10 +1,14 @@
 #ifndef SHARED_H
 #define SHARED_H
 
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include "bitmap.h"
+
 #define sys _system
 
 #define BUFFER_LENGTH 4096
@@ -16,21 +20,80 @@
 #define PERMS (S_IRUSR | S_IWUSR)
 
 #define PATH_LOG "output.log"
-#define TIMEOUT 2
-#define PROCESSES_MAX 18
-#define PROCESSES_TOTAL 40
+#define PATH_CHECKPOINT "oss.ckpt"
+#define TIMEOUT 2	/* Real seconds a run lasts at most, unless it has a simulated length */
+#define PROCESSES_MAX 18	/* Default limit of processes alive at once */
+#define PROCESSES_TOTAL 40	/* Default number of processes spawned over a run */
+#define REFERENCE_BUDGET 1000	/* Default references a process makes before it terminates */
 
 #define PAGE_COUNT 32
 #define PROCESS_SIZE (PAGE_COUNT * 1000)
 #define PAGE_SIZE 1000
 #define MAX_PAGES (PROCESS_SIZE / PAGE_SIZE)
+#define PAGE_SHIFT 10	/* Addresses keep the page number above a 1 KiB offset, so physical ones do the same with the frame */
 
 #define MEMORY_COUNT 256
 #define MEMORY_SIZE (MEMORY_COUNT * 1000)
 #define FRAME_SIZE PAGE_SIZE
 #define MAX_FRAMES (MEMORY_SIZE / FRAME_SIZE)
+#define COW_COPY_US 2000	/* Copying a page on a copy-on-write fault, twice a local access */
+
+#define HUGE_PAGE_PAGES 8	/* Base pages per huge page, one aligned run of frames */
+#define HUGE_MAX_PTES_NONE (HUGE_PAGE_PAGES / 2)	/* Missing pages a region may have and still collapse */
+#define HUGE_SCAN_INTERVAL (100 * 1000000)	/* Simulated ns between collapse scans */
+#define HUGE_SCAN_REGIONS 16	/* Regions looked at per collapse scan */
+#define TLB_ENTRIES 64
+
+#define MAX_NODES 8
+#define NUMA_LOCAL_DISTANCE 10	/* Distance at which an access costs the base access time */
+#define NUMA_REMOTE_DISTANCE 20
+
+#define ZSWAP_RATIO 3.0	/* Compressed pages stored per backing frame */
+#define ZSWAP_COMPRESS_US 50
+#define ZSWAP_DECOMPRESS_US 100
+
+#define TIER_SLOW_DISTANCE 30	/* Default distance to the slow tier, three times the local access time */
+#define TIER_SCAN_INTERVAL (100 * 1000000)	/* Simulated ns between tier scans */
+#define TIER_REF_HEAT 4	/* Heat a sampled reference adds, halved every scan */
+#define TIER_HOT_HEAT 6	/* Heat at which a slow tier page is promoted */
+#define TIER_MIGRATE_MAX 8	/* Promotions per tier scan */
+
+#define MAX_CACHES 3
+#define CACHE_DEFAULT "4096:4,16384:4,65536:8"	/* L1, L2 and LLC as size:ways */
+#define CACHE_LINE 64
+#define CACHE_L1_NS 1
+#define CACHE_L2_NS 4
+#define CACHE_LLC_NS 15
+#define CACHE_MEM_NS 80	/* Memory behind the caches, at local distance */
+
+#define AGING_TICK (20 * 1000000)	/* Default simulated ns between aging ticks */
+#define AGE_NEW 0x80	/* Counter of a page just brought in, as if referenced in the last tick */
+
+#define DUEL_SAMPLE 4	/* One page in this many is fed to the shadow policies */
+#define DUEL_WINDOW 256	/* Sampled references between policy decisions */
+#define DUEL_MARGIN 0.02	/* Miss ratio a shadow policy has to beat the live one by */
+
+#define KSWAPD_INTERVAL (5 * 1000000)	/* Simulated ns between background reclaim passes */
+#define KSWAPD_BATCH 16	/* Pages a background reclaim pass evicts at most */
+#define LOAD_INTERVAL (50 * 1000000)	/* Simulated ns between load control decisions */
+#define LOAD_FREE_SHARE 16	/* Without watermarks, memory is short once fewer than 1/16 of the frames are free */
+#define LOAD_MIN_RUNNING 2	/* Load control never suspends below this many running processes */
+
+#define WSS_REGIONS 8	/* Default regions per process the working-set sampler watches one page of */
+
+#define EVENT_POLL_EVERY 64	/* Loop iterations between signal checks while no user process is exiting */
+#define EVENT_BATCH 16	/* Signals read from the signalfd at once */
+
+#define MAX_THREADS 16
+#define PAGEVEC_SIZE 15	/* LRU updates a worker batches before taking the LRU lock */
+#define MSG_REPLY 1	/* Reply type in serial mode */
+#define MSG_REPLY_WORKER (1 << 24)	/* Reply type base per worker thread, above any PID */
 
 enum SchemeType { RANDOM, WEIGHTED };
+enum MessageKind { MSG_RUN, MSG_ASSIGN, MSG_RETIRE };	/* Make a reference, take on a simulated process, or exit the pool */
+enum HugeMode { HUGE_NEVER, HUGE_ALWAYS, HUGE_DEFER };
+enum NumaPolicy { NUMA_LOCAL, NUMA_INTERLEAVE, NUMA_PREFERRED };
+enum ReplacePolicy { POLICY_LRU, POLICY_AGING, POLICY_CLOCK, POLICY_ADAPTIVE };	/* Adaptive picks among the ones before it */
 
 typedef unsigned int uint;
 
@@ -41,30 +104,84 @@ typedef struct {
 
 typedef struct {
 	long type;
+	int kind;
 	pid_t p_id;
 	int sp_id;
 	bool terminate;
+	int schm;	/* Scheme of the simulated process a pool worker takes on */
+	long reply;	/* Type the user process replies with */
 	unsigned int addr;
 	unsigned int pg;
+	unsigned int seed;	/* Generator state after this reference */
+	int refs;	/* References made so far */
+	int budget;	/* References a pool worker's new simulated process makes in all */
 } Message;
 
+/* One 32-bit word per page; valid, dirty and referenced live in the bitmaps of System instead */
 typedef struct {
-	uint frm;
-	uint addr: 8;
-	uint protec;
-	uint dirty;
-	uint valid;
+	uint32_t frm: 16;	/* PTE_NO_FRAME when not resident */
+	uint32_t protec: 1;
+	uint32_t huge: 1;	/* Part of a huge page mapping */
+	uint32_t zswap: 1;	/* Evicted into the compressed tier */
+	uint32_t unused: 13;
 } PTE;
 
+#define PTE_NO_FRAME 0xffff
+#if MAX_FRAMES >= PTE_NO_FRAME
+#error "frame numbers do not fit in a PTE"
+#endif
+#define PT_WORDS BITMAP_WORDS(MAX_PAGES)	/* Bitmap words per page table */
+
+#define FRAME_SHARED -2	/* Frame owner of a page in the shared segment */
+
+typedef struct {
+	int sp_id;	/* Owning process, -1 when free or FRAME_SHARED */
+	int pg;
+	int refs;	/* Number of page tables mapping this frame */
+	int heat;	/* Sampled references, decayed by the tier scan */
+} Frame;
+
+typedef struct {
+	int base;	/* First frame of the node */
+	int size;
+	int cursor;	/* Where the nxt free frame search in this node starts */
+} Node;
+
+/* A simulation worker thread in parallel mode */
+typedef struct {
+	pthread_t thread;
+	int id;
+	unsigned int seed;
+	struct TLB *tlb;	/* Each worker is a CPU with its own TLB */
+	pthread_mutex_t tlbLock;
+	int pvCount;	/* Pending LRU updates, in the style of a Linux pagevec */
+	int pvSpid[PAGEVEC_SIZE];
+	int pvPg[PAGEVEC_SIZE];
+	int pvFrm[PAGEVEC_SIZE];
+} Worker;
+
+/* Lives in the simulator's own memory, allocated while the process is alive */
 typedef struct {
 	pid_t p_id;
 	int sp_id;
+	unsigned int seed;	/* Last reported generator state, used to resume after a restore */
+	int refs;
+	int node;	/* Home NUMA node */
+	pthread_mutex_t lock;	/* Guards the page table in parallel mode */
 	PTE p_table[MAX_PAGES];
+
+	/* Page table flags as one bitmap per flag, so scans over them can count and shift whole words */
+	uint32_t valid[PT_WORDS];
+	uint32_t dirty[PT_WORDS];
+	uint32_t referenced[PT_WORDS];	/* Set on access, sampled and cleared by background scans */
+	uint32_t idle[PT_WORDS];	/* Set by the working-set sampler, cleared on access */
+
+	int wssSample[MAX_PAGES];	/* Page the working-set sampler watches in each region, -1 for none */
+	int wss;	/* Latest working-set estimate in pages */
 } PCB;
 
 typedef struct {
 	SysTime clock;
-	PCB p_table[PROCESSES_MAX];
 } System;
 
 #endif
@@ -0,0 +1,96 @@
+#include <stdlib.h>
+
+#include "shared.h"
+#include "tlb.h"
+
+TLB *newTLB(int size)
+{
+	TLB *tlb = (TLB*) malloc(sizeof(TLB));
+	tlb->entries = (TLBEntry*) malloc(size * sizeof(TLBEntry));
+	tlb->size = size;
+	tlb->tick = 0;
+	tlb->hits = 0;
+	tlb->misses = 0;
+	tlb->reach = 0;
+	tlb->reachSum = 0;
+
+	int i;
+	for (i = 0; i < size; i++)
+		tlb->entries[i].sp_id = -1;
+	return tlb;
+}
+
+static int entryReach(const TLBEntry *entry)
+{
+	if (entry->sp_id == -1)
+		return 0;
+	return entry->huge ? HUGE_PAGE_PAGES : 1;
+}
+
+static bool isCovering(const TLBEntry *entry, int sp_id, int pg)
+{
+	if (entry->sp_id != sp_id)
+		return false;
+	return entry->huge ? entry->tag == pg / HUGE_PAGE_PAGES : entry->tag == pg;
+}
+
+/* Translates a page, filling the least recently used entry on a miss; returns whether it hit */
+bool tlbLookup(TLB *tlb, int sp_id, int pg, bool huge)
+{
+	int victim = 0;
+	int i;
+
+	tlb->tick++;
+	for (i = 0; i < tlb->size; i++)
+	{
+		TLBEntry *entry = &tlb->entries[i];
+		if (isCovering(entry, sp_id, pg))
+		{
+			entry->used = tlb->tick;
+			tlb->hits++;
+			tlb->reachSum += tlb->reach;
+			return true;
+		}
+		if (tlb->entries[victim].sp_id != -1 && (entry->sp_id == -1 || entry->used < tlb->entries[victim].used))
+			victim = i;
+	}
+
+	tlb->misses++;
+	tlb->reach -= entryReach(&tlb->entries[victim]);
+	tlb->entries[victim].sp_id = sp_id;
+	tlb->entries[victim].tag = huge ? pg / HUGE_PAGE_PAGES : pg;
+	tlb->entries[victim].huge = huge;
+	tlb->entries[victim].used = tlb->tick;
+	tlb->reach += entryReach(&tlb->entries[victim]);
+	tlb->reachSum += tlb->reach;
+	return false;
+}
+
+/* Drops any entry translating the given page of a process */
+void tlbInvalidate(TLB *tlb, int sp_id, int pg)
+{
+	int i;
+	for (i = 0; i < tlb->size; i++)
+		if (isCovering(&tlb->entries[i], sp_id, pg))
+		{
+			tlb->reach -= entryReach(&tlb->entries[i]);
+			tlb->entries[i].sp_id = -1;
+		}
+}
+
+void tlbFlushProcess(TLB *tlb, int sp_id)
+{
+	int i;
+	for (i = 0; i < tlb->size; i++)
+		if (tlb->entries[i].sp_id == sp_id)
+		{
+			tlb->reach -= entryReach(&tlb->entries[i]);
+			tlb->entries[i].sp_id = -1;
+		}
+}
+
+/* Returns how many base pages the current entries translate */
+int tlbReach(const TLB *tlb)
+{
+	return tlb->reach;
+}
@@ -0,0 +1,30 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdbool.h>
+
+typedef struct {
+	int sp_id;	/* -1 when the entry is empty */
+	int tag;	/* Page number, or huge page number for a huge entry */
+	bool huge;
+	unsigned long used;
+} TLBEntry;
+
+/* Fully associative TLB with LRU replacement, tagged by simulated PID */
+typedef struct TLB {
+	TLBEntry *entries;
+	int size;
+	unsigned long tick;
+	int hits;
+	int misses;
+	int reach;	/* Base pages translated by the current entries */
+	double reachSum;	/* Reach summed over every lookup, for averaging */
+} TLB;
+
+TLB *newTLB(int);
+bool tlbLookup(TLB*, int, int, bool);
+void tlbInvalidate(TLB*, int, int);
+void tlbFlushProcess(TLB*, int);
+int tlbReach(const TLB*);
+
+#endif
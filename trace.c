@@ -0,0 +1,251 @@
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/* Moves the window so it starts at the nxt unparsed byte, keeping a partial line or record; returns false at the end */
+static bool refill(Trace *trace)
+{
+	if (trace->eof)
+		return false;
+
+	if (trace->mapped)
+	{
+		struct stat st;
+		off_t start = trace->offset + trace->pos;
+		off_t aligned = start - start % sysconf(_SC_PAGESIZE);
+
+		if (fstat(trace->fd, &st) == -1 || start >= st.st_size)
+			return false;
+		if (trace->window != NULL)
+			munmap(trace->window - trace->offset % sysconf(_SC_PAGESIZE), trace->len + trace->offset % sysconf(_SC_PAGESIZE));
+
+		size_t len = (st.st_size - aligned < TRACE_WINDOW) ? st.st_size - aligned : TRACE_WINDOW;
+		char *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, trace->fd, aligned);
+		if (map == MAP_FAILED)
+		{
+			trace->window = NULL;
+			return false;
+		}
+		madvise(map, len, MADV_SEQUENTIAL);
+
+		/* Present the window as starting at the unparsed byte */
+		trace->window = map + (start - aligned);
+		trace->len = len - (start - aligned);
+		trace->offset = start;
+		trace->pos = 0;
+		trace->eof = (aligned + (off_t) len >= st.st_size);
+		return trace->len > 0;
+	}
+
+	/* Streams keep the unparsed tail and read more behind it */
+	size_t keep = trace->len - trace->pos;
+	memmove(trace->window, trace->window + trace->pos, keep);
+	trace->offset += trace->pos;
+	trace->pos = 0;
+	trace->len = keep;
+	while (trace->len < TRACE_WINDOW)
+	{
+		ssize_t n = read(trace->fd, trace->window + trace->len, TRACE_WINDOW - trace->len);
+		if (n <= 0)
+		{
+			trace->eof = true;
+			break;
+		}
+		trace->len += n;
+	}
+	return trace->len > keep;
+}
+
+/* Returns the nxt complete line in place, without its newline, or NULL at the end */
+static char *nextLine(Trace *trace, size_t *len)
+{
+	while (true)
+	{
+		char *line = trace->window + trace->pos;
+		char *end = memchr(line, '\n', trace->len - trace->pos);
+
+		if (end != NULL)
+		{
+			*len = end - line;
+			trace->pos += *len + 1;
+			return line;
+		}
+
+		/* A line longer than the window cannot be a reference, so hand it over as it is */
+		if (trace->pos == 0 && trace->len >= TRACE_WINDOW)
+		{
+			*len = trace->len;
+			trace->pos = trace->len;
+			return line;
+		}
+		if (!refill(trace))
+		{
+			/* A last line without a newline */
+			*len = trace->len - trace->pos;
+			trace->pos = trace->len;
+			return (*len > 0) ? line : NULL;
+		}
+	}
+}
+
+static unsigned long long parseHex(const char *p, const char *end, const char **stop)
+{
+	unsigned long long v = 0;
+	while (p < end && isxdigit((unsigned char) *p))
+	{
+		v = v * 16 + (isdigit((unsigned char) *p) ? *p - '0' : tolower((unsigned char) *p) - 'a' + 10);
+		p++;
+	}
+	*stop = p;
+	return v;
+}
+
+static unsigned long long parseNumber(const char *p, const char *end, const char **stop)
+{
+	unsigned long long v = 0;
+	if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+		return parseHex(p + 2, end, stop);
+	while (p < end && isdigit((unsigned char) *p))
+		v = v * 10 + (*p++ - '0');
+	*stop = p;
+	return v;
+}
+
+/* Lackey lines look like "I  0400d7d4,8", " L 04222cac,8", " S ...", " M ..." */
+static bool parseLackey(const char *p, const char *end, TraceRef *ref)
+{
+	while (p < end && *p == ' ')
+		p++;
+	if (p == end || strchr("ILSM", *p) == NULL)
+		return false;
+
+	ref->write = (*p == 'S' || *p == 'M');
+	p++;
+	while (p < end && *p == ' ')
+		p++;
+	if (p == end || !isxdigit((unsigned char) *p))
+		return false;
+	ref->addr = parseHex(p, end, &p);
+	ref->proc = 0;
+	return p < end && *p == ',';
+}
+
+/* CSV lines are "process,address,R|W", the address decimal or 0x hex; anything else is skipped */
+static bool parseCsv(const char *p, const char *end, TraceRef *ref)
+{
+	if (p == end || !isdigit((unsigned char) *p))
+		return false;
+	ref->proc = parseNumber(p, end, &p);
+	if (p == end || *p++ != ',')
+		return false;
+	ref->addr = parseNumber(p, end, &p);
+	if (p == end || *p++ != ',')
+		return false;
+	while (p < end && *p == ' ')
+		p++;
+	if (p == end)
+		return false;
+	ref->write = (*p == 'W' || *p == 'w' || *p == '1');
+	return true;
+}
+
+/* Guesses the format from the first bytes: the binary magic, a Lackey line, or else CSV */
+static int detectFormat(Trace *trace)
+{
+	if (trace->len >= 4 && memcmp(trace->window, TRACE_MAGIC, 4) == 0)
+		return TRACE_BINARY;
+
+	const char *p = trace->window;
+	const char *end = trace->window + trace->len;
+	while (p < end)
+	{
+		const char *eol = memchr(p, '\n', end - p);
+		TraceRef ref;
+		if (eol == NULL)
+			eol = end;
+		if (parseLackey(p, eol, &ref))
+			return TRACE_LACKEY;
+		if (parseCsv(p, eol, &ref))
+			return TRACE_CSV;
+		p = eol + 1;
+	}
+	return TRACE_CSV;
+}
+
+bool traceOpen(Trace *trace, const char *path, int format)
+{
+	memset(trace, 0, sizeof(Trace));
+	trace->fd = (strcmp(path, "-") == 0) ? STDIN_FILENO : open(path, O_RDONLY);
+	if (trace->fd == -1)
+		return false;
+
+	/* Map regular files; pipes and the like are read through a buffer */
+	struct stat st;
+	trace->mapped = fstat(trace->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+	if (!trace->mapped && (trace->window = malloc(TRACE_WINDOW)) == NULL)
+		return false;
+	if (!refill(trace))
+		return false;
+
+	trace->format = (format == TRACE_AUTO) ? detectFormat(trace) : format;
+	if (trace->format == TRACE_BINARY)
+	{
+		if (trace->len < 8 || memcmp(trace->window, TRACE_MAGIC, 4) != 0 || trace->window[4] != TRACE_VERSION)
+			return false;
+		trace->pos = 8;
+	}
+	return true;
+}
+
+/* Parses the nxt reference; returns false at the end of the trace */
+bool traceNext(Trace *trace, TraceRef *ref)
+{
+	if (trace->format == TRACE_BINARY)
+	{
+		if (trace->len - trace->pos < sizeof(uint64_t) && (!refill(trace) || trace->len - trace->pos < sizeof(uint64_t)))
+			return false;
+
+		const unsigned char *b = (const unsigned char*) trace->window + trace->pos;
+		uint64_t word = 0;
+		int i;
+		for (i = 7; i >= 0; i--)
+			word = (word << 8) | b[i];
+		trace->pos += sizeof(uint64_t);
+
+		ref->addr = word & TRACE_ADDR_MASK;
+		ref->proc = (word >> TRACE_PROC_SHIFT) & 0xff;
+		ref->write = (word & TRACE_WRITE) != 0;
+		trace->refs++;
+		return true;
+	}
+
+	size_t len;
+	char *line;
+	while ((line = nextLine(trace, &len)) != NULL)
+	{
+		bool ok = (trace->format == TRACE_LACKEY) ? parseLackey(line, line + len, ref) : parseCsv(line, line + len, ref);
+		if (ok)
+		{
+			trace->refs++;
+			return true;
+		}
+		trace->skipped++;
+	}
+	return false;
+}
+
+void traceClose(Trace *trace)
+{
+	if (trace->mapped && trace->window != NULL)
+		munmap(trace->window - trace->offset % sysconf(_SC_PAGESIZE), trace->len + trace->offset % sysconf(_SC_PAGESIZE));
+	else
+		free(trace->window);
+	if (trace->fd > STDIN_FILENO)
+		close(trace->fd);
+}
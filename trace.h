@@ -0,0 +1,48 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define TRACE_MAGIC "OSST"
+#define TRACE_VERSION 1
+#define TRACE_WINDOW (64 * 1024 * 1024)	/* Bytes of the trace mapped or buffered at a time */
+
+enum TraceFormat { TRACE_AUTO, TRACE_LACKEY, TRACE_CSV, TRACE_BINARY };
+
+/*
+ * Binary records are little-endian 64-bit words after an 8 byte header of
+ * TRACE_MAGIC and the version: bits 0-47 hold the address, bits 48-55 the
+ * process and bit 63 is set for a write.
+ */
+#define TRACE_ADDR_MASK ((1ULL << 48) - 1)
+#define TRACE_PROC_SHIFT 48
+#define TRACE_WRITE (1ULL << 63)
+
+typedef struct {
+	int proc;
+	unsigned long long addr;
+	bool write;
+} TraceRef;
+
+/* Reads a trace through a window that slides over the file, mapped when possible and read otherwise */
+typedef struct {
+	int fd;
+	int format;
+	bool mapped;	/* Window is an mmap of the file rather than a buffer */
+	char *window;
+	size_t len;	/* Valid bytes in the window */
+	size_t pos;	/* Nxt byte to parse */
+	off_t offset;	/* File offset of the window */
+	bool eof;	/* Nothing left past the window */
+	long refs;
+	long skipped;	/* Lines that were not references */
+} Trace;
+
+bool traceOpen(Trace*, const char*, int);
+bool traceNext(Trace*, TraceRef*);
+void traceClose(Trace*);
+
+#endif
@@ -50,29 +50,42 @@ void init_IPC() {
 int main(int argc, char *argv[]) {
 	init(argc, argv);
 
-	int sp_id = atoi(argv[1]);
-	int schm = atoi(argv[2]);
+	/* A pool worker has no simulated process of its own until OSS assigns one */
+	bool pooled = (argc > 1 && strcmp(argv[1], "pool") == 0);
+	int schm = pooled ? -1 : atoi(argv[2]);
 
-	srand(time(NULL) ^ getpid());
+	/* OSS hands us our generator state, so a restored run picks up where it left off */
+	unsigned int seed = (argc > 3) ? strtoul(argv[3], NULL, 10) : time(NULL) ^ getpid();
+	int referenceCount = (argc > 4) ? atoi(argv[4]) : 0;
+	int budget = (argc > 5) ? atoi(argv[5]) : REFERENCE_BUDGET;
 
 	init_IPC();
 
 	bool terminate = false;
-	int referenceCount = 0;
 	unsigned int addr = 0;
 	unsigned int pg = 0;
 
 	/* Decision loop */
 	while (true) {
 		/* Wait until we get a msg from OSS telling us it's our turn to "run" */
-		msgrcv(msq_id, &msg, sizeof(Message), getpid(), 0);
-
-		/* Continue getting addr if we haven't referenced to our limit (1000) */
-		if (referenceCount <= 1000) {
+		msgrcv(msq_id, &msg, sizeof(Message) - sizeof(long), getpid(), 0);
+
+		/* Take on a new simulated process, starting from a clean state */
+		if (msg.kind == MSG_ASSIGN) {
+			schm = msg.schm;
+			seed = msg.seed;
+			referenceCount = msg.refs;
+			budget = msg.budget;
+			terminate = false;
+			continue;
+		} else if (msg.kind == MSG_RETIRE) break;
+
+		/* Continue getting addr if we haven't referenced to our budget */
+		if (referenceCount < budget) {
 			if (schm == RANDOM) {
 				/* Execute simple schm algorithm */
 
-				addr = rand() % 32768 + 0;
+				addr = rand_r(&seed) % 32768 + 0;
 				pg = addr >> 10;
 			} else if (schm == WEIGHTED) {
 				/* Execute weighted schm algorithm */
@@ -93,7 +106,7 @@ int main(int argc, char *argv[]) {
 					weights[i] = sum;
 				}
 
-				r = rand() % ((int) weights[PAGE_COUNT - 1] + 1);
+				r = rand_r(&seed) % ((int) weights[PAGE_COUNT - 1] + 1);
 				i =0;
 				while(i < PAGE_COUNT)
 				{
@@ -104,7 +117,7 @@ int main(int argc, char *argv[]) {
 					i++;
 				}
 				
-				addr = (p << 10) + (rand() % 1024);
+				addr = (p << 10) + (rand_r(&seed) % 1024);
 				pg = p;
 			} else crash("Unknown scheme!");
 
@@ -112,16 +125,18 @@ int main(int argc, char *argv[]) {
 		} else terminate = true;
 
 		/* Send our decision to OSS */
-		msg.type = 1;
+		msg.type = msg.reply;
 		msg.terminate = terminate;
 		msg.addr = addr;
 		msg.pg = pg;
-		msgsnd(msq_id, &msg, sizeof(Message), 0);
+		msg.seed = seed;
+		msg.refs = referenceCount;
+		msgsnd(msq_id, &msg, sizeof(Message) - sizeof(long), 0);
 
-		if (terminate) break;
+		if (terminate && !pooled) break;
 	}
 
-	return sp_id;
+	return EXIT_SUCCESS;
 }
 
 